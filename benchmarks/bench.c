@@ -0,0 +1,197 @@
+/*
+ * bench.c
+ *
+ * Throughput microbenchmarks for the nanofuzz generator core. Each entry in the
+ *   corpus below stresses one pattern mechanism (static strings, ranges, nested
+ *   subsequences, branches, variable references) and is driven straight through
+ *   Generator__get_next() against the static library, bypassing the CLI and the
+ *   output stack entirely.
+ *
+ * For every pattern the harness runs a warmup pass, then several timed
+ *   repetitions, and reports outputs/sec and MB/sec as mean +/- stddev across
+ *   the repetitions plus heap allocations per generated output. Intended use:
+ *   'make bench' before and after a change; a real interpreter regression shows
+ *   up as a drop well outside the reported spread.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../src/api.h"
+
+
+// Repetitions per pattern; the per-rep iteration count comes from argv (or this default).
+#define BENCH_DEFAULT_ITERS 20000
+#define BENCH_REPS 5
+// Warmup fraction: one tenth of a repetition, floored at 100 outputs.
+#define BENCH_MIN_WARMUP 100
+
+
+
+// Allocation counting: override the allocators binary-wide and forward to glibc.
+//   Only the counter differs from stock behavior, so the library under test is
+//   measured without any instrumentation inside it.
+extern void* __libc_malloc( size_t size );
+extern void* __libc_calloc( size_t nmemb, size_t size );
+extern void* __libc_realloc( void* ptr, size_t size );
+extern void __libc_free( void* ptr );
+
+static unsigned long long _alloc_count = 0;
+
+void* malloc( size_t size ) {  _alloc_count++; return __libc_malloc( size );  }
+void* calloc( size_t nmemb, size_t size ) {  _alloc_count++; return __libc_calloc( nmemb, size );  }
+void* realloc( void* ptr, size_t size ) {  _alloc_count++; return __libc_realloc( ptr, size );  }
+void free( void* ptr ) {  __libc_free( ptr );  }
+
+
+
+// The benchmark corpus: one representative pattern per mechanism family.
+typedef struct _bench_case_t {
+    const char* name;
+    const char* pattern;
+} bench_case_t;
+
+static const bench_case_t bench_corpus[] = {
+    { "pure-static",     "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ" },
+    { "static-repeat",   "HEADER-(payload){5,25}-FOOTER" },
+    { "range-heavy",     "[a-z,A-Z,0-9]{256}" },
+    { "range-wide",      "[a-z]{16,4096}" },
+    { "deep-nested",     "a(b(c(d(e){2,5}){2,4}f){1,3}g){2,4}h" },
+    { "branch-heavy",    "(aa|bb|cc|dd|ee|ff|gg|hh){32}" },
+    { "reference-heavy", "([a-f]{8})<$V>:<@V><@V><#d4:V>" },
+    { "ref-shuffle",     "([0-9]{4})<$Q><@Q>(-<%Q><@Q>){8}" },
+};
+#define BENCH_CORPUS_SIZE ( sizeof(bench_corpus) / sizeof(bench_case_t) )
+
+
+
+// Monotonic wall-clock seconds.
+static double __now_sec( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (  (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9)  );
+}
+
+
+// Generate 'iters' outputs, freeing each as the CLI would. Returns the total
+//   generated byte count, or 0 on any generation fault.
+static unsigned long long __bench_run_once( fuzz_gen_ctx_t* p_gctx, size_t iters ) {
+    unsigned long long bytes = 0;
+
+    for ( size_t i = 0; i < iters; i++ ) {
+        fuzz_str_t* p_data = Generator__get_next( p_gctx );
+        if ( NULL == p_data )  return 0;
+
+        bytes += p_data->length;
+
+        free( (void*)(p_data->output) );
+        free( (void*)p_data );
+    }
+
+    return bytes;
+}
+
+
+// Run one corpus entry: warmup, then BENCH_REPS timed repetitions.
+//   Returns non-zero on success.
+static int __bench_case( const bench_case_t* p_case, size_t iters ) {
+    fuzz_error_t* p_err = NULL;
+    fuzz_factory_t* p_factory = PatternFactory__new( p_case->pattern, &p_err );
+
+    if ( NULL == p_factory ) {
+        fprintf( stderr, "[%s] failed to parse its pattern:\n", p_case->name );
+        Error__print( p_err, stderr );
+        return 0;
+    }
+
+    fuzz_gen_ctx_t* p_gctx = Generator__new_context( p_factory );
+    if ( NULL == p_gctx ) {
+        fprintf( stderr, "[%s] failed to create a generator context.\n", p_case->name );
+        PatternFactory__delete( p_factory );
+        return 0;
+    }
+
+    // Warmup: fault caches, the allocator, and any lazily-built scratch.
+    size_t warmup = ( (iters / 10) > BENCH_MIN_WARMUP ) ? (iters / 10) : BENCH_MIN_WARMUP;
+    if (  !__bench_run_once( p_gctx, warmup )  ) {
+        fprintf( stderr, "[%s] generation faulted during warmup.\n", p_case->name );
+        Generator__delete_context( p_gctx );
+        return 0;
+    }
+
+    double ops_rate[BENCH_REPS];
+    double mb_rate[BENCH_REPS];
+    double allocs_per_op = 0;
+
+    for ( size_t rep = 0; rep < BENCH_REPS; rep++ ) {
+        unsigned long long allocs_before = _alloc_count;
+
+        double t0 = __now_sec();
+        unsigned long long bytes = __bench_run_once( p_gctx, iters );
+        double elapsed = ( __now_sec() - t0 );
+
+        if ( !bytes ) {
+            fprintf( stderr, "[%s] generation faulted mid-run.\n", p_case->name );
+            Generator__delete_context( p_gctx );
+            return 0;
+        }
+
+        ops_rate[rep] = ( (double)iters / elapsed );
+        mb_rate[rep] = ( ((double)bytes / (1024.0 * 1024.0)) / elapsed );
+        allocs_per_op += ( (double)(_alloc_count - allocs_before) / (double)iters );
+    }
+    allocs_per_op /= (double)BENCH_REPS;
+
+    // Mean and standard deviation of the per-rep throughput.
+    double ops_mean = 0, mb_mean = 0;
+    for ( size_t rep = 0; rep < BENCH_REPS; rep++ ) {
+        ops_mean += ops_rate[rep];
+        mb_mean += mb_rate[rep];
+    }
+    ops_mean /= (double)BENCH_REPS;
+    mb_mean /= (double)BENCH_REPS;
+
+    double ops_var = 0;
+    for ( size_t rep = 0; rep < BENCH_REPS; rep++ )
+        ops_var += ( (ops_rate[rep] - ops_mean) * (ops_rate[rep] - ops_mean) );
+    double ops_stddev = sqrt( ops_var / (double)BENCH_REPS );
+
+    printf( "  %-16s  %12.0f +/- %8.0f ops/sec  %10.2f MB/sec  %7.2f allocs/op\n",
+        p_case->name, ops_mean, ops_stddev, mb_mean, allocs_per_op );
+
+    Generator__delete_context( p_gctx );   //also deletes the factory
+    return 1;
+}
+
+
+
+int main( int argc, char* const argv[] ) {
+    size_t iters = BENCH_DEFAULT_ITERS;
+
+    if ( argc > 1 ) {
+        iters = (size_t)strtoul( argv[1], NULL, 10 );
+        if ( iters < 1 ) {
+            fprintf( stderr, "Usage: %s [iterations-per-repetition]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    printf( "=== nanofuzz generator benchmarks"
+        " (%lu iterations x %d repetitions per pattern) ===\n",
+        (unsigned long)iters, BENCH_REPS );
+
+    int failures = 0;
+    for ( size_t i = 0; i < BENCH_CORPUS_SIZE; i++ )
+        failures += !__bench_case( &(bench_corpus[i]), iters );
+
+    if ( failures ) {
+        fprintf( stderr, "\n%d benchmark case(s) FAILED to run.\n", failures );
+        return 1;
+    }
+
+    return 0;
+}
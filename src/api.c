@@ -5,33 +5,96 @@
  *
  */
 
+#define _GNU_SOURCE   /* pthread_setaffinity_np */
+
 #include "api.h"
 
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <unistd.h>
 
 
 
-// Create a structure that wraps a simple stack, a stack type, and a thread mutex
-//   to control asynchronous stack operations.
+// Maximum amount of generator batches which can be alive (i.e. still have outputs
+//   lent out to the API consumer) at once before pushes fall back to per-item copies.
+#define FUZZ_MAX_LIVE_BATCHES 16
+
+// Assumed cache-line size for padding the ring indices apart (avoids false sharing).
+#define FUZZ_CACHE_LINE_SIZE 64
+
+// A single ring cell. The per-cell sequence number implements the classic bounded
+//   MPMC queue handshake: producers and consumers race only on head/tail CAS ops
+//   and never take a lock on the fast path.
+typedef struct _fuzz_output_ring_cell_t {
+    _Atomic size_t seq;
+    nanofuzz_data_t data;
+} fuzz_output_ring_cell_t;
+
+// A lock-free multi-producer/multi-consumer ring buffer of generated outputs.
+//   'head' (enqueue) and 'tail' (dequeue) sit on their own cache lines. The mutex
+//   here no longer guards push/pop; it only covers the live-batch bookkeeping and
+//   the producer-wakeup condvar below.
 struct _fuzz_output_stack_t {
-    void* p_base;
-    size_t size;
-    size_t data_size;
-    size_t count;
+    fuzz_output_ring_cell_t* p_cells;
+    size_t size;   // requested capacity
+    size_t mask;   // (pow2 cell count - 1) for cheap index wrapping
+    char _pad0[FUZZ_CACHE_LINE_SIZE];
+    _Atomic size_t head;   // next enqueue position
+    char _pad1[FUZZ_CACHE_LINE_SIZE];
+    _Atomic size_t tail;   // next dequeue position
+    char _pad2[FUZZ_CACHE_LINE_SIZE];
     nanofuzz_stack_type type;
-    pthread_mutex_t mutex;
     size_t is_error;
+    pthread_mutex_t mutex;   // live-batch bookkeeping + wakeup condvar
+    pthread_cond_t wake_cond;   // signaled by consumers when producers nap on a full ring
+    pthread_cond_t fill_cond;   // signaled by producers after each pushed batch
+    _Atomic int producers_waiting;   // producers blocked on 'wake_cond' for a free slot
+    _Atomic int consumers_waiting;   // consumers blocked on 'fill_cond' for the next batch
+    // Refill hysteresis: producers nap until the ring drains BELOW this mark, then
+    //   top it back up to capacity in one batch. Producers adapt the mark from the
+    //   drain they observe while generating (see the refresh loop), so fast
+    //   consumers get earlier/bigger refills and slow ones get fewer wakeups.
+    _Atomic size_t low_water;
+    // Recycled pop wrappers, chained through their 'output' field and guarded by
+    //   'mutex'. Returned items feed the next pops instead of heap round-trips.
+    nanofuzz_data_t* p_wrapper_freelist;
+    size_t wrapper_freelist_count;   // capped at 'size' so the list stays bounded
 };
 
+// Tracks one live generator batch whose arena still backs outputs that were handed
+//   to the consumer. Once the producer stops pushing from it ('retired') and every
+//   lent item comes back through Nanofuzz__delete_data, the batch is freed.
+typedef struct _fuzz_batch_slot_t {
+    fuzz_batch_t* p_batch;
+    size_t outstanding;   // items pushed from this batch and not yet returned
+    int retired;   // producer is done pushing from this batch
+} fuzz_batch_slot_t;
+
+// One producer thread's slot: its handle plus the generator state it generates
+//   from. The first slot runs over the context's primary gen ctx (guarded by the
+//   gen mutex); any further slots own private clones and need no lock at all.
+typedef struct _fuzz_producer_slot_t {
+    struct _fuzz_global_context_t* p_parent;
+    fuzz_gen_ctx_t* p_gen_ctx;
+    pthread_t thread;
+} fuzz_producer_slot_t;
+
 // Define a structure which encapsulates the parent factory and gen ctx.
 // This type is the primary type for interaction with nanofuzz's generator.
 struct _fuzz_global_context_t {
     fuzz_factory_t* _p_parent_factory;
     fuzz_gen_ctx_t* _p_gen_ctx;
     nanofuzz_output_stack_t _stack;
-    pthread_t _generator;
+    fuzz_batch_slot_t _batches[FUZZ_MAX_LIVE_BATCHES];   // guarded by the stack mutex
+    fuzz_producer_slot_t _producers[FUZZ_MAX_PRODUCERS];
+    size_t _producer_count;
+    // Count of producer threads which have NOT yet acknowledged shutdown. The
+    //   deleter must wait for this to hit zero before freeing anything a producer
+    //   can still touch; each producer's final act is decrementing it.
+    _Atomic size_t _producers_live;
+    pthread_mutex_t _gen_mutex;   // serializes direct generator use vs. the first producer
 };
 
 
@@ -41,8 +104,22 @@ struct _fuzz_global_context_t {
 static void* Nanofuzz__thread_refresh_context( void* _p_ctx );   //worker thread function.
 static int Nanofuzz__output_stack_push( nanofuzz_output_stack_t* p_stack, nanofuzz_data_t* p_data );
 static nanofuzz_data_t* Nanofuzz__output_stack_pop( nanofuzz_output_stack_t* p_stack );
+static int Nanofuzz__output_stack_push_batch( nanofuzz_context_t* p_ctx, fuzz_batch_t* p_batch );
+static nanofuzz_context_t* __Nanofuzz__new( const char* p_pattern, size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type, size_t producers, int is_seeded, uint64_t seed,
+    nanofuzz_error_t** pp_err_ctx );
+static int __Nanofuzz__init_stack( nanofuzz_context_t* p_ctx, size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type, size_t producers );
 ////////////////////////////////////////////////////////////////////////////////////
 
+// Approximate count of currently-queued outputs. Racy by nature, exact enough for
+//   fill-level decisions.
+static inline size_t Nanofuzz__output_stack_count( nanofuzz_output_stack_t* p_stack ) {
+    size_t head = atomic_load_explicit( &(p_stack->head), memory_order_relaxed );
+    size_t tail = atomic_load_explicit( &(p_stack->tail), memory_order_relaxed );
+    return ( head > tail ) ? (head - tail) : 0;
+}
+
 
 
 // Init function; uses the provided string to instantiate a new fuzzer.
@@ -51,6 +128,48 @@ nanofuzz_context_t* Nanofuzz__new(
     size_t output_stack_size,
     nanofuzz_stack_type output_stack_type,
     nanofuzz_error_t** pp_err_ctx
+) {
+    return __Nanofuzz__new( p_pattern, output_stack_size, output_stack_type, 1, 0, 0, pp_err_ctx );
+}
+
+
+// Multi-producer init variant; see the header for semantics.
+nanofuzz_context_t* Nanofuzz__new_parallel(
+    const char* p_pattern,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type,
+    size_t producers,
+    nanofuzz_error_t** pp_err_ctx
+) {
+    if ( producers < 1 )  producers = 1;
+    if ( producers > FUZZ_MAX_PRODUCERS )  producers = FUZZ_MAX_PRODUCERS;
+
+    return __Nanofuzz__new( p_pattern, output_stack_size, output_stack_type,
+        producers, 0, 0, pp_err_ctx );
+}
+
+
+// Seeded init variant for reproducible runs; see the header for details.
+nanofuzz_context_t* Nanofuzz__new_seeded(
+    const char* p_pattern,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type,
+    uint64_t seed,
+    nanofuzz_error_t** pp_err_ctx
+) {
+    return __Nanofuzz__new( p_pattern, output_stack_size, output_stack_type, 1, 1, seed, pp_err_ctx );
+}
+
+
+// Common context construction underlying both init flavors.
+static nanofuzz_context_t* __Nanofuzz__new(
+    const char* p_pattern,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type,
+    size_t producers,
+    int is_seeded,
+    uint64_t seed,
+    nanofuzz_error_t** pp_err_ctx
 ) {
     // Quick param check.
     if (
@@ -72,79 +191,363 @@ nanofuzz_context_t* Nanofuzz__new(
     // Create a new generator context to prepare output generation.
     p_ctx->_p_gen_ctx = Generator__new_context( p_ctx->_p_parent_factory );
 
+    // For reproducible runs, re-seed the fresh context; the generator derives
+    //   well-separated streams for every variable subcontext from the same seed.
+    if ( is_seeded )
+        Generator__seed_context( p_ctx->_p_gen_ctx, seed );
+
+    // Set up the output stack and its refill thread(s) over the new context.
+    if (  !__Nanofuzz__init_stack( p_ctx, output_stack_size, output_stack_type, producers )  )
+        goto __context_new_err;
+
+    // Return the allocated context.
+    return p_ctx;
+
+    // Jumped to on any error init'ing the ctx.
+    __context_new_err:
+        Nanofuzz__delete( p_ctx );
+        return NULL;
+}
+
+
+// Shared output-stack/refill-thread setup used by both fresh and cloned contexts.
+//   Returns non-zero on success.
+static int __Nanofuzz__init_stack(
+    nanofuzz_context_t* p_ctx,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type,
+    size_t producers
+) {
     // Allocate and set up the stack. The size is sizeof(data)*output_stack_size.
     nanofuzz_output_stack_t* p_stack = &(p_ctx->_stack);
 
     pthread_mutex_init( &(p_stack->mutex), NULL );
+    pthread_cond_init( &(p_stack->wake_cond), NULL );
+    pthread_cond_init( &(p_stack->fill_cond), NULL );
+    pthread_mutex_init( &(p_ctx->_gen_mutex), NULL );
 
     p_stack->type = output_stack_type;
-    p_stack->count = 0;
     p_stack->size = output_stack_size;
     p_stack->is_error = 0;
-    p_stack->data_size = (sizeof(nanofuzz_data_t) * output_stack_size);
 
-    p_stack->p_base = calloc( 1, p_stack->data_size );
-    if ( NULL == p_stack->p_base )
-        goto __context_new_err;
+    atomic_init( &(p_stack->head), 0 );
+    atomic_init( &(p_stack->tail), 0 );
+    atomic_init( &(p_stack->producers_waiting), 0 );
+    atomic_init( &(p_stack->consumers_waiting), 0 );
+    atomic_init( &(p_stack->low_water), (output_stack_size / 2) );
+    atomic_init( &(p_ctx->_producers_live), 0 );
+
+    // The cell count must be a power of two so positions wrap with a simple mask.
+    size_t cells = 1;
+    while ( cells < output_stack_size )  cells <<= 1;
+    p_stack->mask = (cells - 1);
+
+    p_stack->p_cells = (fuzz_output_ring_cell_t*)calloc( cells, sizeof(fuzz_output_ring_cell_t) );
+    if ( NULL == p_stack->p_cells )
+        return 0;
 
-    // Spin up the new pthread (detached) and start it immediately.
+    // Prime each cell's sequence number with its own index (ring starts empty).
+    for ( size_t i = 0; i < cells; i++ )
+        atomic_init( &((p_stack->p_cells[i]).seq), i );
+
+    // Oneshot stacks are filled exactly once and never touched again, so there is
+    //   no reason for a producer thread (or for waiting on one): generate the whole
+    //   fill as a single batch right here and return.
+    if ( oneshot == output_stack_type ) {
+        fuzz_batch_t* p_batch = Generator__get_next_n( p_ctx->_p_gen_ctx, p_stack->size );
+
+        if (  NULL == p_batch || !Nanofuzz__output_stack_push_batch( p_ctx, p_batch )  )
+            p_stack->is_error = 1;
+
+        return 1;
+    }
+
+    // Refill stacks spin up the detached producer pthread(s) and return immediately;
+    //   consumers that outpace them block on 'fill_cond' (see Nanofuzz__get_next)
+    //   rather than this thread polling for the initial fill to finish.
+    //   The first producer drives the context's primary generator state; each
+    //   additional one gets a private clone (own PRNG stream, own pool) over the
+    //   same immutable factory, so they all push into the one MPMC ring without
+    //   ever contending on generation state.
     pthread_attr_t tattr;
     pthread_attr_init( &tattr );
     pthread_attr_setdetachstate( &tattr, 1 );
 
-    int rc = pthread_create( &(p_ctx->_generator), &tattr,
-        Nanofuzz__thread_refresh_context, p_ctx );
-    if ( rc )
-        goto __context_new_err;
+    if ( producers < 1 )  producers = 1;
+    if ( producers > FUZZ_MAX_PRODUCERS )  producers = FUZZ_MAX_PRODUCERS;
 
-    // Temporarily wait until the generator is done.
-    volatile unsigned long long int x = 0;
-    while ( x < 0xFFFFFFFFFFFFFFF0 && p_stack->count < p_stack->size ) {
-        usleep( 100 );
-        x++;
+    for ( size_t i = 0; i < producers; i++ ) {
+        fuzz_producer_slot_t* p_slot = &(p_ctx->_producers[i]);
+
+        p_slot->p_parent = p_ctx;
+        p_slot->p_gen_ctx = ( 0 == i )
+            ? p_ctx->_p_gen_ctx
+            : Generator__clone_context( p_ctx->_p_gen_ctx )
+        ;
+
+        if ( NULL == p_slot->p_gen_ctx )
+            return 0;
+
+        p_ctx->_producer_count = (i + 1);
+
+        // Registered BEFORE the thread exists so the deleter can never observe a
+        //   running producer it isn't waiting on.
+        atomic_fetch_add_explicit( &(p_ctx->_producers_live), 1, memory_order_release );
+
+        if (  pthread_create( &(p_slot->thread), &tattr,
+                Nanofuzz__thread_refresh_context, p_slot )  ) {
+            atomic_fetch_sub_explicit( &(p_ctx->_producers_live), 1, memory_order_release );
+            return 0;
+        }
     }
 
-    // Check for error conditions (such as generator overflow).
+    return 1;
+}
+
+
+// Wrap an already-compiled factory in a fresh context; no parsing happens here.
+nanofuzz_context_t* Nanofuzz__new_from_factory(
+    fuzz_factory_t* p_factory,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type
+) {
+    if (
+           NULL == p_factory
+        || 0 == output_stack_size
+        || (nanofuzz_stack_type)NULL == output_stack_type
+    )  return NULL;
+
+    nanofuzz_context_t* p_ctx = (nanofuzz_context_t*)calloc( 1, sizeof(nanofuzz_context_t) );
+    if ( NULL == p_ctx )
+        return NULL;
+
+    p_ctx->_p_parent_factory = p_factory;
+    p_ctx->_p_gen_ctx = Generator__new_context( p_factory );   //takes ownership
+
+    if (
+           NULL == p_ctx->_p_gen_ctx
+        || !__Nanofuzz__init_stack( p_ctx, output_stack_size, output_stack_type, 1 )
+    ) {
+        Nanofuzz__delete( p_ctx );
+        return NULL;
+    }
 
-    // Return the allocated context.
     return p_ctx;
+}
 
-    // Jumped to on any error init'ing the ctx.
-    __context_new_err:
+
+// Clone an existing context: the compiled factory stays shared (it is immutable
+//   after the parse), while the clone gets its own generator state, output stack,
+//   and refill thread. The source context must outlive its clones.
+nanofuzz_context_t* Nanofuzz__clone(
+    nanofuzz_context_t* p_source,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type
+) {
+    if (
+           NULL == p_source
+        || 0 == output_stack_size
+        || (nanofuzz_stack_type)NULL == output_stack_type
+    )  return NULL;
+
+    nanofuzz_context_t* p_ctx = (nanofuzz_context_t*)calloc( 1, sizeof(nanofuzz_context_t) );
+    if ( NULL == p_ctx )
+        return NULL;
+
+    // Borrow the parsed factory; the cloned generator context does not own it,
+    //   so deleting the clone leaves the source context fully intact.
+    p_ctx->_p_parent_factory = p_source->_p_parent_factory;
+    p_ctx->_p_gen_ctx = Generator__clone_context( p_source->_p_gen_ctx );
+
+    if (
+           NULL == p_ctx->_p_gen_ctx
+        || !__Nanofuzz__init_stack( p_ctx, output_stack_size, output_stack_type, 1 )
+    ) {
         Nanofuzz__delete( p_ctx );
         return NULL;
+    }
+
+    return p_ctx;
 }
 
 
 // Destroy function to free all Nanofuzz context resources.
 void Nanofuzz__delete( nanofuzz_context_t* p_ctx ) {
     if ( NULL != p_ctx ) {
-        free( (p_ctx->_stack).p_base );
-        (p_ctx->_stack).p_base = NULL;
+        // Flag the refill threads down and wake any napping on the wake condvar;
+        //   any consumers parked on an empty ring are released the same way.
+        (p_ctx->_stack).is_error = 1;
+        pthread_mutex_lock( &((p_ctx->_stack).mutex) );
+        pthread_cond_broadcast( &((p_ctx->_stack).wake_cond) );
+        pthread_cond_broadcast( &((p_ctx->_stack).fill_cond) );
+        pthread_mutex_unlock( &((p_ctx->_stack).mutex) );
+
+        // NOTHING below this point may be freed until every producer acknowledges
+        //   the shutdown: one can be mid-batch reading factory operands, or about
+        //   to re-lock the stack mutex after a wakeup. The broadcast is repeated
+        //   because a producer can re-enter its condvar wait between our flag
+        //   write and its predicate check.
+        while (  atomic_load_explicit( &(p_ctx->_producers_live), memory_order_acquire ) > 0  ) {
+            pthread_mutex_lock( &((p_ctx->_stack).mutex) );
+            pthread_cond_broadcast( &((p_ctx->_stack).wake_cond) );
+            pthread_mutex_unlock( &((p_ctx->_stack).mutex) );
+
+            usleep( 500 );   //producers mid-generation can take a moment to notice
+        }
+
+        free( (p_ctx->_stack).p_cells );
+        (p_ctx->_stack).p_cells = NULL;
+
+        // Drain the recycled-wrapper freelist.
+        while ( NULL != (p_ctx->_stack).p_wrapper_freelist ) {
+            nanofuzz_data_t* p_next =
+                (nanofuzz_data_t*)((p_ctx->_stack).p_wrapper_freelist->output);
+            free( (p_ctx->_stack).p_wrapper_freelist );
+            (p_ctx->_stack).p_wrapper_freelist = p_next;
+        }
+
+        // Free any still-live batches; lent-out items die with their arenas here.
+        for ( size_t i = 0; i < FUZZ_MAX_LIVE_BATCHES; i++ ) {
+            Generator__delete_batch( (p_ctx->_batches[i]).p_batch );
+            (p_ctx->_batches[i]).p_batch = NULL;
+        }
+
+        // Release the private clone contexts owned by the extra producer slots;
+        //   slot 0 is just the primary generator context and is deleted below.
+        for ( size_t i = 0; i < p_ctx->_producer_count; i++ ) {
+            if (
+                   NULL != (p_ctx->_producers[i]).p_gen_ctx
+                && (p_ctx->_producers[i]).p_gen_ctx != p_ctx->_p_gen_ctx
+            )  Generator__delete_context( (p_ctx->_producers[i]).p_gen_ctx );
 
-        Generator__delete_context( p_ctx->_p_gen_ctx );   //also deletes factory resources
+            (p_ctx->_producers[i]).p_gen_ctx = NULL;
+        }
+
+        Generator__delete_context( p_ctx->_p_gen_ctx );   //deletes factory resources too, when owned
     }
 
     free( p_ctx );
 }
 
 
-// Get a newly-generated item.
+// Get a newly-generated item. For refill stacks, an empty ring means the consumer
+//   is ahead of the producer (or arrived before the first batch landed, since
+//   construction no longer waits for the initial fill): block on the fill condvar
+//   until the producer publishes more items, instead of failing the pop.
 nanofuzz_data_t* Nanofuzz__get_next( nanofuzz_context_t* p_ctx ) {
     if ( NULL == p_ctx )  return NULL;
 
-    return Nanofuzz__output_stack_pop( &(p_ctx->_stack) );
+    nanofuzz_output_stack_t* p_stack = &(p_ctx->_stack);
+    nanofuzz_data_t* p_data = Nanofuzz__output_stack_pop( p_stack );
+
+    while ( NULL == p_data && refill == p_stack->type && 0 == p_stack->is_error ) {
+        pthread_mutex_lock( &(p_stack->mutex) );
+        atomic_fetch_add_explicit( &(p_stack->consumers_waiting), 1, memory_order_release );
+
+        // Re-check under the lock: the producer pushes first and only then takes
+        //   this mutex to signal, so a miss here means the wait will be woken.
+        if (
+               0 == Nanofuzz__output_stack_count( p_stack )
+            && 0 == p_stack->is_error
+        ) {
+            pthread_cond_wait( &(p_stack->fill_cond), &(p_stack->mutex) );
+        }
+
+        atomic_fetch_sub_explicit( &(p_stack->consumers_waiting), 1, memory_order_release );
+        pthread_mutex_unlock( &(p_stack->mutex) );
+
+        p_data = Nanofuzz__output_stack_pop( p_stack );
+    }
+
+    return p_data;
+}
+
+
+// Lend the generator's own data pool to the caller, skipping the stack and every
+//   copy on the way out. Intended for write-and-discard (e.g. pipe-to-target) flows.
+const nanofuzz_data_t* Nanofuzz__get_next_view( nanofuzz_context_t* p_ctx ) {
+    if ( NULL == p_ctx )  return NULL;
+
+    pthread_mutex_lock( &(p_ctx->_gen_mutex) );
+    const nanofuzz_data_t* p_view = Generator__peek_next( p_ctx->_p_gen_ctx );
+    pthread_mutex_unlock( &(p_ctx->_gen_mutex) );
+
+    return p_view;
+}
+
+
+// Deterministically regenerate one output from its (seed, iteration) coordinate.
+nanofuzz_data_t* Nanofuzz__replay( nanofuzz_context_t* p_ctx, uint64_t seed, uint64_t iteration ) {
+    if ( NULL == p_ctx )  return NULL;
+
+    return (nanofuzz_data_t*)Generator__replay( p_ctx->_p_gen_ctx, seed, iteration );
 }
 
 
-// Free generated nanofuzz data. This is a simple wrspper and we leave leak tracking up
-//   to the implementer of the API since DATA blobs are context-independent.
+// Return the seed underneath the context's generator stream.
+uint64_t Nanofuzz__get_seed( nanofuzz_context_t* p_ctx ) {
+    if ( NULL == p_ctx )  return 0;
+
+    return Generator__get_seed( p_ctx->_p_gen_ctx );
+}
+
+
+// Free generated nanofuzz data. When the data's output points into a live batch
+//   arena, only the wrapper struct is freed and the arena's outstanding count is
+//   decremented; the arena itself is released once every lent item comes back.
 void Nanofuzz__delete_data( nanofuzz_context_t* p_ctx, nanofuzz_data_t* p_data ) {
     if ( NULL != p_data ) {
         if ( NULL != p_data->output ) {
-            free( (void*)p_data->output );
+            int was_arena_backed = 0;
+
+            if ( NULL != p_ctx ) {
+                pthread_mutex_lock( &((p_ctx->_stack).mutex) );
+
+                for ( size_t i = 0; i < FUZZ_MAX_LIVE_BATCHES; i++ ) {
+                    fuzz_batch_slot_t* p_slot = &(p_ctx->_batches[i]);
+                    if ( NULL == p_slot->p_batch )  continue;
+
+                    if (
+                           (unsigned char*)(p_data->output) >= p_slot->p_batch->p_arena
+                        && (unsigned char*)(p_data->output)
+                            < (p_slot->p_batch->p_arena + p_slot->p_batch->arena_size)
+                    ) {
+                        was_arena_backed = 1;
+                        p_slot->outstanding--;
+
+                        // Drop the whole batch once the producer retired it and all
+                        //   of its items have been returned.
+                        if ( p_slot->retired && 0 == p_slot->outstanding ) {
+                            Generator__delete_batch( p_slot->p_batch );
+                            p_slot->p_batch = NULL;
+                        }
+                        break;
+                    }
+                }
+
+                pthread_mutex_unlock( &((p_ctx->_stack).mutex) );
+            }
+
+            if ( !was_arena_backed )
+                free( (void*)p_data->output );
+
             p_data->output = NULL;
         }
+
+        // Recycle the wrapper into the stack's bounded freelist so the next pop
+        //   skips the heap; overflow (or a missing context) falls back to free().
+        if ( NULL != p_ctx ) {
+            nanofuzz_output_stack_t* p_stack = &(p_ctx->_stack);
+
+            pthread_mutex_lock( &(p_stack->mutex) );
+            if ( p_stack->wrapper_freelist_count < p_stack->size ) {
+                p_data->output = (const void*)(p_stack->p_wrapper_freelist);
+                p_stack->p_wrapper_freelist = p_data;
+                p_stack->wrapper_freelist_count++;
+                p_data = NULL;
+            }
+            pthread_mutex_unlock( &(p_stack->mutex) );
+        }
     }
 
     free( p_data );
@@ -160,99 +563,333 @@ void Nanofuzz__PatternFactory__explain( FILE* fp_stream, nanofuzz_context_t* p_f
 
 
 
+// Pin the context's producer threads to one CPU. The pools and batch arenas are
+//   lazy mappings placed by first touch, so a producer that stops migrating keeps
+//   all of its generation writes on its own NUMA node; see the header.
+void Nanofuzz__pin_producers( nanofuzz_context_t* p_ctx, int cpu ) {
+    if ( NULL == p_ctx || cpu < 0 )  return;
 
-////////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////////
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu, &set );
 
-// Main thread loop to initally populate a stack and/or continue refilling it.
-static void* Nanofuzz__thread_refresh_context( void* _p_ctx ) {
-    nanofuzz_context_t* p_ctx = (nanofuzz_context_t*)_p_ctx;
-    nanofuzz_output_stack_t* p_stack = &(p_ctx->_stack);
+    // Best-effort per the contract: a shrunken cpuset or dead thread is not fatal.
+    for ( size_t i = 0; i < p_ctx->_producer_count; i++ )
+        pthread_setaffinity_np( (p_ctx->_producers[i]).thread, sizeof(cpu_set_t), &set );
+}
 
-    // For 'oneshot' stack types, fill the data stack and quit.
-    if ( oneshot == p_stack->type ) {
-        size_t generated = 0;
 
-        while ( generated < p_stack->size ) {
-            nanofuzz_data_t* p_data = Generator__get_next( p_ctx->_p_gen_ctx );
-            if ( NULL == p_data ) {
-                p_stack->is_error = 1;
-                return NULL;
-            }
 
-            Nanofuzz__output_stack_push( p_stack, p_data );
+// Merge the context's generation statistics into the caller's block. The counters
+//   are maintained without atomics by the generating thread, so a snapshot taken
+//   while the refill producer is live is approximate rather than exact.
+void Nanofuzz__get_stats( nanofuzz_context_t* p_ctx, nanofuzz_stats_t* p_stats ) {
+    if ( NULL == p_ctx || NULL == p_stats )  return;
 
-            free( p_data );   //this data is memcpy'd, so the outer ptr can be freed
-            generated++;
-        }
+    Generator__get_stats( p_ctx->_p_gen_ctx, p_stats );
 
-        return NULL;
+    // Fold in the private clone contexts driven by any extra producer threads.
+    for ( size_t i = 1; i < p_ctx->_producer_count; i++ ) {
+        if (
+               NULL == (p_ctx->_producers[i]).p_gen_ctx
+            || (p_ctx->_producers[i]).p_gen_ctx == p_ctx->_p_gen_ctx
+        )  continue;
+
+        nanofuzz_stats_t clone_stats;
+        Generator__get_stats( (p_ctx->_producers[i]).p_gen_ctx, &clone_stats );
+        Stats__merge( p_stats, &clone_stats );
     }
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////
+
+// Notify any consumers blocked on an empty ring that items (or an error) landed.
+static inline void Nanofuzz__output_stack_notify_fill( nanofuzz_output_stack_t* p_stack ) {
+    if (  atomic_load_explicit( &(p_stack->consumers_waiting), memory_order_acquire )  ) {
+        pthread_mutex_lock( &(p_stack->mutex) );
+        pthread_cond_broadcast( &(p_stack->fill_cond) );
+        pthread_mutex_unlock( &(p_stack->mutex) );
+    }
+}
+
+
+// Main producer loop for 'refill' stacks, replenishing the ring as items are taken.
+//   Oneshot stacks are filled inline at construction and never start this thread.
+//   One instance runs per producer slot: the first slot drives the context's primary
+//   generator state (under '_gen_mutex', which also serializes the synchronous
+//   view/seed paths against it), while every later slot owns a private clone and
+//   generates completely lock-free. All of them race only on the MPMC ring itself.
+static void* Nanofuzz__thread_refresh_context( void* _p_slot ) {
+    fuzz_producer_slot_t* p_slot = (fuzz_producer_slot_t*)_p_slot;
+    nanofuzz_context_t* p_ctx = p_slot->p_parent;
+    nanofuzz_output_stack_t* p_stack = &(p_ctx->_stack);
+    int is_primary = (p_slot->p_gen_ctx == p_ctx->_p_gen_ctx);
 
-    // 'Refill' types keep the thread alive to replenish the stack as items are taken.
     while ( 1 ) {
-        // If there's nothing to generate, keep waiting.
-        if ( p_stack->count >= p_stack->size ) {
-            usleep( 10000 );
-            continue;
+        // Hysteresis: sleep until the ring drains below the low-water mark, not
+        //   merely until one slot frees up. The consumer pop that crosses the mark
+        //   signals, the whole drained span is regenerated as ONE batch below, and
+        //   the producer goes back to sleep -- so the lock/wake traffic scales with
+        //   drain CYCLES instead of with items.
+        pthread_mutex_lock( &(p_stack->mutex) );
+        atomic_fetch_add_explicit( &(p_stack->producers_waiting), 1, memory_order_release );
+        while (
+               Nanofuzz__output_stack_count( p_stack )
+                 > atomic_load_explicit( &(p_stack->low_water), memory_order_relaxed )
+            && 0 == p_stack->is_error
+        ) {
+            pthread_cond_wait( &(p_stack->wake_cond), &(p_stack->mutex) );
+        }
+        atomic_fetch_sub_explicit( &(p_stack->producers_waiting), 1, memory_order_release );
+        pthread_mutex_unlock( &(p_stack->mutex) );
+
+        // Check for errors in output generation (or a shutdown in progress).
+        if ( 0 != p_stack->is_error ) {
+            Nanofuzz__output_stack_notify_fill( p_stack );
+            goto __producer_exit;
         }
 
-        // Check for errors in output generation.
-        if ( 0 != p_stack->is_error )
-            return NULL;
+        size_t count_before = Nanofuzz__output_stack_count( p_stack );
+        size_t free_slots = (p_stack->size - count_before);
+        if ( 0 == free_slots )
+            continue;
 
-        // Generate and push to stack.
-        nanofuzz_data_t* p_data = Generator__get_next( p_ctx->_p_gen_ctx );
-        if ( NULL == p_data ) {
+        // Cap each producer's claim at its share of the ring so concurrent batches
+        //   don't collectively overshoot the capacity and waste generated items.
+        size_t claim_cap = (p_stack->size / p_ctx->_producer_count);
+        if ( claim_cap < 1 )
+            claim_cap = 1;
+        if ( free_slots > claim_cap )
+            free_slots = claim_cap;
+
+        // Generate the claimed slots in a single batch and push them all.
+        //   Consumers can only free up more room in the meantime, never less.
+        fuzz_batch_t* p_batch;
+        if ( is_primary ) {
+            pthread_mutex_lock( &(p_ctx->_gen_mutex) );
+            p_batch = Generator__get_next_n( p_slot->p_gen_ctx, free_slots );
+            pthread_mutex_unlock( &(p_ctx->_gen_mutex) );
+        } else {
+            p_batch = Generator__get_next_n( p_slot->p_gen_ctx, free_slots );
+        }
+        if ( NULL == p_batch ) {
             p_stack->is_error = 1;
-            return NULL;
+            Nanofuzz__output_stack_notify_fill( p_stack );
+            goto __producer_exit;
         }
 
-        Nanofuzz__output_stack_push( p_stack, p_data );
+        if (  !Nanofuzz__output_stack_push_batch( p_ctx, p_batch )  ) {
+            p_stack->is_error = 1;
+            Nanofuzz__output_stack_notify_fill( p_stack );
+            goto __producer_exit;
+        }
 
-        p_data->output = NULL;   // change this so the output can remain but output ptr is NULL
-        free( p_data );
+        // Adapt the mark to the drain rate observed while this batch generated.
+        //   Consumers that nearly kept pace get an earlier (and therefore bigger)
+        //   next refill so they never bottom out the ring; a trickle drain lets
+        //   the ring coast further down between wakeups instead.
+        size_t count_after = Nanofuzz__output_stack_count( p_stack );
+        size_t drained = ( (count_before + free_slots) > count_after )
+            ? ((count_before + free_slots) - count_after)
+            : 0
+        ;
+
+        size_t mark = atomic_load_explicit( &(p_stack->low_water), memory_order_relaxed );
+        if (  drained > 0 && (drained * 2) >= free_slots  )
+            mark += ((p_stack->size - mark) / 2);
+        else if ( drained < (free_slots / 8) )
+            mark /= 2;
+
+        if ( mark > (p_stack->size - 1) )
+            mark = (p_stack->size - 1);
+        atomic_store_explicit( &(p_stack->low_water), mark, memory_order_relaxed );
+
+        // Wake anyone who went to sleep on the (previously) empty ring.
+        Nanofuzz__output_stack_notify_fill( p_stack );
     }
+
+    __producer_exit:
+        // Acknowledge shutdown as the VERY LAST touch of the shared context: once
+        //   this decrement lands, Nanofuzz__delete is free to tear everything down.
+        atomic_fetch_sub_explicit( &(p_ctx->_producers_live), 1, memory_order_release );
+        return NULL;
 }
 
 
-// Push a data pointer onto the stack.
+// Enqueue a data record into the ring. Lock-free: claims a position with a CAS on
+//   'head', writes the cell, then publishes it by bumping the cell sequence.
 static int Nanofuzz__output_stack_push(
     nanofuzz_output_stack_t* p_stack,
     nanofuzz_data_t* p_data
 ) {
-    if ( p_stack->count >= p_stack->size )
+    // Respect the REQUESTED capacity, which can be below the pow2 cell count.
+    if ( Nanofuzz__output_stack_count( p_stack ) >= p_stack->size )
         return 0;
 
-    pthread_mutex_lock( &(p_stack->mutex) );
+    fuzz_output_ring_cell_t* p_cell;
+    size_t pos = atomic_load_explicit( &(p_stack->head), memory_order_relaxed );
+
+    for ( ; ; ) {
+        p_cell = &(p_stack->p_cells[pos & p_stack->mask]);
+        size_t seq = atomic_load_explicit( &(p_cell->seq), memory_order_acquire );
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if ( 0 == diff ) {
+            if (  atomic_compare_exchange_weak_explicit( &(p_stack->head), &pos, (pos + 1),
+                    memory_order_relaxed, memory_order_relaxed )  )
+                break;
+        } else if ( diff < 0 ) {
+            return 0;   //ring is full
+        } else {
+            pos = atomic_load_explicit( &(p_stack->head), memory_order_relaxed );
+        }
+    }
+
+    p_cell->data = *p_data;
+    atomic_store_explicit( &(p_cell->seq), (pos + 1), memory_order_release );
 
-    memcpy(
-        (p_stack->p_base + (sizeof(nanofuzz_data_t)*(p_stack->count))),
-        p_data,
-        sizeof(nanofuzz_data_t)
-    );
-    p_stack->count++;
+    return 1;
+}
+
+
+// Push every record of a generated batch onto the stack, tracking the batch in a
+//   live slot so its arena outlives the items lent out to the consumer. When no
+//   slot is free, degrade gracefully to pushing per-item heap copies instead.
+//   Returns 0 only on a hard failure; the batch is always consumed.
+static int Nanofuzz__output_stack_push_batch( nanofuzz_context_t* p_ctx, fuzz_batch_t* p_batch ) {
+    if ( NULL == p_ctx || NULL == p_batch )  return 0;
+
+    nanofuzz_output_stack_t* p_stack = &(p_ctx->_stack);
 
+    // Find a free live-batch slot, if any.
+    fuzz_batch_slot_t* p_slot = NULL;
+
+    pthread_mutex_lock( &(p_stack->mutex) );
+    for ( size_t i = 0; i < FUZZ_MAX_LIVE_BATCHES; i++ ) {
+        if ( NULL == (p_ctx->_batches[i]).p_batch ) {
+            p_slot = &(p_ctx->_batches[i]);
+            p_slot->p_batch = p_batch;
+            p_slot->outstanding = 0;
+            p_slot->retired = 0;
+            break;
+        }
+    }
     pthread_mutex_unlock( &(p_stack->mutex) );
 
+    // Push each record, either as an arena view or as a standalone heap copy.
+    for ( size_t i = 0; i < p_batch->count; i++ ) {
+        fuzz_str_rec_t* p_rec = &(p_batch->p_records[i]);
+        nanofuzz_data_t data;
+
+        if ( NULL != p_slot ) {
+            data.output = (const void*)(p_batch->p_arena + p_rec->offset);
+            data.length = p_rec->length;
+        } else {
+            // No slot available: copy out so the item owns its bytes the classic way.
+            void* p_copy = calloc( (p_rec->length + 1), sizeof(char) );
+            if ( NULL == p_copy ) {
+                // Even a hard failure consumes the batch, as promised above;
+                //   neither caller frees it on a zero return.
+                Generator__delete_batch( p_batch );
+                return 0;
+            }
+
+            memcpy( p_copy, (p_batch->p_arena + p_rec->offset), p_rec->length );
+            data.output = (const void*)p_copy;
+            data.length = p_rec->length;
+        }
+
+        if (  !Nanofuzz__output_stack_push( p_stack, &data )  ) {
+            if ( NULL == p_slot )  free( (void*)data.output );
+            break;   //stack is full; remaining items are simply dropped
+        }
+
+        if ( NULL != p_slot ) {
+            pthread_mutex_lock( &(p_stack->mutex) );
+            p_slot->outstanding++;
+            pthread_mutex_unlock( &(p_stack->mutex) );
+        }
+    }
+
+    // Retire the slot (the producer adds nothing more from this batch), or free
+    //   the copied-out batch immediately.
+    if ( NULL != p_slot ) {
+        pthread_mutex_lock( &(p_stack->mutex) );
+        p_slot->retired = 1;
+        if ( 0 == p_slot->outstanding ) {
+            Generator__delete_batch( p_slot->p_batch );
+            p_slot->p_batch = NULL;
+        }
+        pthread_mutex_unlock( &(p_stack->mutex) );
+    } else {
+        Generator__delete_batch( p_batch );
+    }
+
     return 1;
 }
 
 
-// Pop the most recent stack item.
+// Dequeue the oldest queued item. Lock-free fast path: one CAS on 'tail' per pop.
+//   If the producer is asleep on a full ring, the freed slot is signaled right away.
 static nanofuzz_data_t* Nanofuzz__output_stack_pop( nanofuzz_output_stack_t* p_stack ) {
-    if ( !(p_stack->count) )  return NULL;
+    fuzz_output_ring_cell_t* p_cell;
+    size_t pos = atomic_load_explicit( &(p_stack->tail), memory_order_relaxed );
+
+    for ( ; ; ) {
+        p_cell = &(p_stack->p_cells[pos & p_stack->mask]);
+        size_t seq = atomic_load_explicit( &(p_cell->seq), memory_order_acquire );
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if ( 0 == diff ) {
+            if (  atomic_compare_exchange_weak_explicit( &(p_stack->tail), &pos, (pos + 1),
+                    memory_order_relaxed, memory_order_relaxed )  )
+                break;
+        } else if ( diff < 0 ) {
+            return NULL;   //ring is empty
+        } else {
+            pos = atomic_load_explicit( &(p_stack->tail), memory_order_relaxed );
+        }
+    }
+
+    // The ring cell is recycled, so the record must still be copied out into a
+    //   standalone wrapper the caller owns (and later returns via delete_data).
+    //   Prefer a recycled wrapper from the freelist over a fresh heap object.
+    nanofuzz_data_t* p_data_copy = NULL;
 
     pthread_mutex_lock( &(p_stack->mutex) );
+    if ( NULL != p_stack->p_wrapper_freelist ) {
+        p_data_copy = p_stack->p_wrapper_freelist;
+        p_stack->p_wrapper_freelist = (nanofuzz_data_t*)(p_data_copy->output);
+        p_stack->wrapper_freelist_count--;
+    }
+    pthread_mutex_unlock( &(p_stack->mutex) );
 
-    p_stack->count--;
-    nanofuzz_data_t* p_data = (p_stack->p_base + (sizeof(nanofuzz_data_t)*(p_stack->count)));
+    if ( NULL == p_data_copy )
+        p_data_copy = (nanofuzz_data_t*)calloc( 1, sizeof(nanofuzz_data_t) );
 
-    nanofuzz_data_t* p_data_copy = (nanofuzz_data_t*)calloc( 1, sizeof(nanofuzz_data_t) );
-    memcpy( p_data_copy, p_data, sizeof(nanofuzz_data_t) );
+    *p_data_copy = p_cell->data;
 
-    pthread_mutex_unlock( &(p_stack->mutex) );
+    // Release the cell for the producer's next lap around the ring.
+    atomic_store_explicit( &(p_cell->seq), (pos + p_stack->mask + 1), memory_order_release );
+
+    // Wake a producer only once the drain crosses the low-water mark; signaling
+    //   every pop would reintroduce exactly the per-item lock/wake traffic the
+    //   hysteresis exists to remove. A signal (not a broadcast) is enough: the
+    //   waiting count is a COUNTER, so other sleeping producers stay discoverable.
+    if (
+           atomic_load_explicit( &(p_stack->producers_waiting), memory_order_acquire )
+        && Nanofuzz__output_stack_count( p_stack )
+             <= atomic_load_explicit( &(p_stack->low_water), memory_order_relaxed )
+    ) {
+        pthread_mutex_lock( &(p_stack->mutex) );
+        pthread_cond_signal( &(p_stack->wake_cond) );
+        pthread_mutex_unlock( &(p_stack->mutex) );
+    }
 
     return p_data_copy;
 }
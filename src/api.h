@@ -32,6 +32,7 @@ void __cyg_profile_func_exit( void* callee, void* caller ) \
 //   to be used externally.
 typedef fuzz_str_t nanofuzz_data_t;
 typedef fuzz_error_t nanofuzz_error_t;
+typedef fuzz_stats_block_t nanofuzz_stats_t;
 
 // Define a structure which encapsulates the parent factory and gen ctx.
 // This type is the primary type for interaction with nanofuzz (and stats in the future).
@@ -40,6 +41,9 @@ typedef struct _fuzz_global_context_t nanofuzz_context_t;
 // Create a structure that wraps a linked list, a chain type, and a thread mutex
 //   to control asynchronous ouput generation.
 typedef struct _fuzz_output_stack_t nanofuzz_output_stack_t;
+
+// Upper bound on producer threads feeding one context's output stack.
+#define FUZZ_MAX_PRODUCERS 16
 typedef enum _fuzz_output_stack_type {
     oneshot = 1,    /**< Fills the output chain one time and does not interact with it anymore. */
     refill          /**< Asynchronously refills the output chain as items are popped. */
@@ -55,12 +59,74 @@ nanofuzz_context_t* Nanofuzz__new(
     nanofuzz_error_t** pp_err_ctx
 );
 
+// Multi-producer init variant: 'producers' generator threads (each with its own
+//   cloned generation state and PRNG stream over the one shared compiled factory)
+//   feed the context's output stack concurrently, so a single context can deliver
+//   multi-core generation bandwidth through the unchanged Nanofuzz__get_next().
+//   Backpressure is the ring buffer itself; counts are clamped to
+//   [1, FUZZ_MAX_PRODUCERS] and only 'refill' stacks use more than one.
+nanofuzz_context_t* Nanofuzz__new_parallel(
+    const char* p_pattern,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type,
+    size_t producers,
+    nanofuzz_error_t** pp_err_ctx
+);
+
+// Seeded init variant: the generator context AND every variable subcontext get
+//   deterministic, well-separated PRNG streams derived from 'seed', so two runs
+//   with the same pattern and seed reproduce the same output sequence.
+nanofuzz_context_t* Nanofuzz__new_seeded(
+    const char* p_pattern,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type,
+    uint64_t seed,
+    nanofuzz_error_t** pp_err_ctx
+);
+
+// Wrap an already-compiled factory (e.g. one loaded via PatternFactory__load_mmap)
+//   in a fresh context, skipping the parser entirely. The context takes ownership
+//   of the factory and releases it on Nanofuzz__delete.
+nanofuzz_context_t* Nanofuzz__new_from_factory(
+    fuzz_factory_t* p_factory,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type
+);
+
+// Clone an existing context for another thread: the immutable compiled factory is
+//   SHARED with the source (no reparse, no duplicated program), while all mutable
+//   generation state, the output stack, and the refill thread are private to the
+//   clone. The source context must outlive every clone made from it.
+nanofuzz_context_t* Nanofuzz__clone(
+    nanofuzz_context_t* p_source,
+    size_t output_stack_size,
+    nanofuzz_stack_type output_stack_type
+);
+
 // Destroy function to free all Nanofuzz context resources.
 void Nanofuzz__delete( nanofuzz_context_t* p_ctx );
 
 // Get a newly-generated item from the output stack of the context.
 nanofuzz_data_t* Nanofuzz__get_next( nanofuzz_context_t* p_ctx );
 
+// Zero-copy variant: generate synchronously and BORROW the generator's data pool.
+//   The returned view bypasses the output stack entirely and stays valid only until
+//   the next call to this function (or any other generation) on the same context.
+//   Never pass the result to Nanofuzz__delete_data(); there is nothing to free.
+const nanofuzz_data_t* Nanofuzz__get_next_view( nanofuzz_context_t* p_ctx );
+
+// Deterministically regenerate output #'iteration' (0-based) of the run seeded
+//   with 'seed', instead of loading it from an archived corpus. The context only
+//   lends its compiled factory; its own generation state is untouched. Free the
+//   result with Nanofuzz__delete_data. Pair with Nanofuzz__get_seed below to
+//   record the 16-byte (seed, iteration) coordinate of an interesting case.
+nanofuzz_data_t* Nanofuzz__replay( nanofuzz_context_t* p_ctx, uint64_t seed, uint64_t iteration );
+
+// Return the seed the context's generator stream was expanded from. Only contexts
+//   built via Nanofuzz__new_seeded (or the CLI's '--seed') produce streams whose
+//   coordinates stay meaningful across runs.
+uint64_t Nanofuzz__get_seed( nanofuzz_context_t* p_ctx );
+
 // Free generated nanofuzz data. This is a simple wrspper and we leave leak tracking up
 //   to the implementer of the API since DATA blobs are context-independent.
 void Nanofuzz__delete_data( nanofuzz_context_t* p_ctx, nanofuzz_data_t* p_data );
@@ -69,6 +135,19 @@ void Nanofuzz__delete_data( nanofuzz_context_t* p_ctx, nanofuzz_data_t* p_data )
 //   This isn't really necessary, but nice to keep the Nanofuzz 'namespace' on the method.
 void Nanofuzz__PatternFactory__explain( FILE* fp_stream, nanofuzz_context_t* p_fuzz_ctx );
 
+// Pin every producer thread the context owns to the given CPU. The point is NUMA
+//   locality: the generator's data pool and batch arenas are lazy mappings whose
+//   pages are placed by FIRST TOUCH, so once the producing thread stops migrating,
+//   everything it writes lands on (and stays on) its own node. Call this right
+//   after building or cloning a context; pass the CPU the consuming thread runs
+//   on (or near) so popped batches are node-local reads too. No-op on failure.
+void Nanofuzz__pin_producers( nanofuzz_context_t* p_ctx, int cpu );
+
+// Snapshot the context's generation statistics (outputs, bytes, per-block-type
+//   execution counts, high-water mark, faults) into the caller's block, merging
+//   the counters of every subcontext child generator. Print with Stats__print.
+void Nanofuzz__get_stats( nanofuzz_context_t* p_ctx, nanofuzz_stats_t* p_stats );
+
 
 
 #endif   /* NANOFUZZ_API_H */
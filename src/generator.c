@@ -10,6 +10,23 @@
 #include "generator.h"
 
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// MADV_FREE (lazy reclaim) appeared in Linux 4.5; fall back to the eager flavor.
+#ifndef MADV_FREE
+#define MADV_FREE MADV_DONTNEED
+#endif
+
+// Only pools whose faulted-in footprint crossed this threshold are ever trimmed;
+//   below it the resident pages are cheaper to keep than to re-fault.
+#define FUZZ_POOL_TRIM_THRESHOLD (1UL << 20)
+
+// Streamed generation bounces output through a window of (at most) this many
+//   bytes at the front of the data pool, flushing to the caller's sink whenever
+//   it fills. Per-context memory for streamed runs is proportional to this, not
+//   to the pattern's worst-case output size.
+#define FUZZ_STREAM_WINDOW_SIZE (1UL << 20)
 
 
 
@@ -22,12 +39,10 @@ static inline uint64_t rotl( const uint64_t x, int k ) {
 }
 
 
-static uint64_t s[2];
-static int s_seeded = 0;
-
-static inline uint64_t Xoshiro128p__next_bounded( uint64_t low, uint64_t high ) {
-    const uint64_t range = 1 + high - low;
-
+// The Xoshiro128+ state now lives INSIDE each generator context ('prng' member),
+//   so parallel contexts never share (or false-share) PRNG cache lines and each
+//   stream can be seeded deterministically for reproducible runs.
+static inline uint64_t Xoshiro128p__next( uint64_t* s ) {
     const uint64_t s0 = s[0];
     uint64_t s1 = s[1];
     const uint64_t result = s0 + s1;
@@ -36,6 +51,13 @@ static inline uint64_t Xoshiro128p__next_bounded( uint64_t low, uint64_t high )
     s[0] = rotl( s0, 24 ) ^ s1 ^ (s1 << 16);
     s[1] = rotl( s1, 37 );
 
+    return result;
+}
+
+static inline uint64_t Xoshiro128p__next_bounded( uint64_t* s, uint64_t low, uint64_t high ) {
+    const uint64_t range = 1 + high - low;
+    const uint64_t result = Xoshiro128p__next( s );
+
     return (
         ( high > low )
         * (
@@ -53,51 +75,304 @@ static inline uint64_t Xoshiro128p__next_bounded( uint64_t low, uint64_t high )
     );
 }
 
-static void Xoshiro128p__init( void ) {
-    uint64_t seed_value;
+// Bulk range kernel: fill 'n' output bytes through a range's precomputed sampling
+//   table. Every PRNG call yields a full 64-bit word which gets sliced into eight
+//   candidate bytes, so wide ranges consume ~1/8th of a PRNG step per output byte
+//   instead of two full bounded draws. Bytes at or above 'accept_limit' are
+//   rejected (see __range_build_lut), keeping the character distribution exactly
+//   uniform with no modulo bias. Returns the number of bytes written.
+// Partially-consumed PRNG word held between chunked fills of ONE range run, so a
+//   run split across streaming flushes consumes exactly the same draw sequence as
+//   the single continuous fill would have -- keeping seeded streamed output
+//   byte-identical to seeded pooled output.
+typedef struct _fuzz_range_carry_t {
+    uint64_t word;   // remaining candidate bytes of the last drawn word
+    int slices;      // how many of them are still unconsumed
+} fuzz_range_carry_t;
+
+static size_t __Generator__fill_range_carry(
+    uint64_t* s,
+    fuzz_range_t* p_range,
+    unsigned char* p_out,
+    size_t n,
+    fuzz_range_carry_t* p_carry
+) {
+    const unsigned short accept_limit = p_range->accept_limit;
+    const unsigned char* p_lut = &(p_range->lut[0]);
+    size_t written = 0;
+
+    uint64_t word = p_carry->word;
+    int avail = p_carry->slices;
+
+    // A zeroed/malformed table must never spin forever below.
+    if ( accept_limit < 1 )  return 0;
+
+    while ( written < n ) {
+        if ( avail < 1 ) {
+            word = Xoshiro128p__next( s );
+            avail = 8;
+        }
+
+        while ( avail > 0 && written < n ) {
+            uint8_t b = (uint8_t)(word & 0xFF);
+            word >>= 8;
+            avail--;
+
+            if ( b < accept_limit )
+                p_out[written++] = p_lut[b];
+        }
+    }
+
+    p_carry->word = word;
+    p_carry->slices = avail;
+
+    return written;
+}
+
+static size_t __Generator__fill_range(
+    uint64_t* s,
+    fuzz_range_t* p_range,
+    unsigned char* p_out,
+    size_t n
+) {
+    // One whole run per call: start with no carried word and discard the leftover.
+    fuzz_range_carry_t carry = { 0, 0 };
+    return __Generator__fill_range_carry( s, p_range, p_out, n, &carry );
+}
+
+// Repetition kernel: write 'iters' back-to-back copies of the 'unit_len'-byte unit
+//   at 'p_unit' into 'p_dest'. Rather than one small memcpy per iteration, the unit
+//   is written once and the already-filled region is then doubled onto itself
+//   (1, 2, 4, 8... units), so {50000}-style repetitions of a short token cost
+//   log2(N) large streaming copies instead of N tiny ones. The caller has already
+//   bounds-checked iters*unit_len. Returns the first byte past the filled region.
+static inline unsigned char* __Generator__fill_repeat(
+    unsigned char* p_dest,
+    const void* p_unit,
+    size_t unit_len,
+    size_t iters
+) {
+    size_t total = (iters * unit_len);
+
+    if ( 0 == total )  return p_dest;
+
+    memcpy( p_dest, p_unit, unit_len );
+
+    for ( size_t filled = unit_len; filled < total; ) {
+        size_t chunk = ( filled <= (total - filled) ) ? filled : (total - filled);
+        memcpy( (p_dest + filled), p_dest, chunk );
+        filled += chunk;
+    }
+
+    return (p_dest + total);
+}
+
+// Hand the filled front of a streaming window to the caller's sink and rewind
+//   the write cursor to the window start. Returns non-zero on success; a sink
+//   refusing a span aborts the whole generation.
+static int __Generator__stream_flush(
+    unsigned char* p_buf,
+    unsigned char** pp_current,
+    fuzz_sink_fn p_sink,
+    void* p_sink_arg,
+    unsigned long long int* p_flushed
+) {
+    size_t filled = (size_t)(*pp_current - p_buf);
+
+    if ( filled > 0 ) {
+        if ( !p_sink( (const void*)p_buf, filled, p_sink_arg ) )
+            return 0;
+
+        *p_flushed += filled;
+        *pp_current = p_buf;
+    }
+
+    return 1;
+}
+
+// Streaming slow path behind __Generator__fill_repeat, taken only when a repeated
+//   run does not fit the remaining window: emit the 'iters' copies through the
+//   window in as-large-as-possible chunks, flushing to the sink as it fills. A
+//   unit wider than the entire window is itself streamed out in pieces, so run
+//   length is never bounded by the window at all. Returns the advanced cursor, or
+//   NULL when no sink is attached (plain bounded generation simply overflows
+//   here) or the sink rejects a flush.
+static unsigned char* __Generator__stream_repeat(
+    unsigned char* p_current,
+    unsigned char* p_buf,
+    unsigned char* p_limit,
+    const void* p_unit,
+    size_t unit_len,
+    size_t iters,
+    fuzz_sink_fn p_sink,
+    void* p_sink_arg,
+    unsigned long long int* p_flushed
+) {
+    if ( NULL == p_sink )  return NULL;
+
+    if ( 0 == unit_len )  return p_current;
+
+    while ( iters > 0 ) {
+        // Mirror the fast path's strict bound: the window keeps one spare byte.
+        size_t space = (size_t)(p_limit - p_current);
+        size_t fit = (space > 0) ? ((space - 1) / unit_len) : 0;
+
+        if ( 0 == fit ) {
+            if ( p_current == p_buf ) {
+                // Even an empty window cannot hold one whole unit: stream the
+                //   unit itself through in pieces.
+                const unsigned char* p_src = (const unsigned char*)p_unit;
+
+                for ( size_t left = unit_len; left > 0; ) {
+                    size_t piece = ((size_t)(p_limit - p_current) - 1);
+
+                    if ( 0 == piece ) {
+                        if ( !__Generator__stream_flush( p_buf, &p_current, p_sink, p_sink_arg, p_flushed ) )
+                            return NULL;
+                        continue;
+                    }
+
+                    if ( piece > left )  piece = left;
+                    memcpy( p_current, p_src, piece );
+
+                    p_current += piece;
+                    p_src += piece;
+                    left -= piece;
+                }
+
+                iters--;
+                continue;
+            }
+
+            if ( !__Generator__stream_flush( p_buf, &p_current, p_sink, p_sink_arg, p_flushed ) )
+                return NULL;
+            continue;
+        }
+
+        if ( fit > iters )  fit = iters;
+        p_current = __Generator__fill_repeat( p_current, p_unit, unit_len, fit );
+        iters -= fit;
+    }
+
+    return p_current;
+}
+
+// Splitmix64 step; the recommended way to expand a 64-bit seed into Xoshiro state.
+//   Feeding successive outputs to different contexts yields well-separated streams.
+static inline uint64_t splitmix64_next( uint64_t* p_x ) {
+    uint64_t z = ( *p_x += 0x9E3779B97F4A7C15ULL );
+    z = ( z ^ (z >> 30) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ (z >> 27) ) * 0x94D049BB133111EBULL;
+    return ( z ^ (z >> 31) );
+}
+
+// Derive a non-deterministic seed for contexts which don't ask for a specific one.
+static uint64_t Xoshiro128p__random_seed( void ) {
     unsigned int lo, hi;
-    tinymt64_t* p_prng_init;
 
     // Get the amount of cycles since the processor was powered on.
     //   This should act as a sufficient non-time-based PRNG seed.
     __asm__ __volatile__ (  "rdtsc" : "=a" (lo), "=d" (hi)  );
-    seed_value = ( ((uint64_t)hi << 32) | lo );
 
-    p_prng_init = (tinymt64_t*)calloc( 1, sizeof(tinymt64_t) );
-    tinymt64_init( p_prng_init, seed_value );
+    // Mix in a process-local counter so contexts spun up back-to-back (or on
+    //   different cores with synced TSCs) still get distinct streams.
+    static uint64_t creation_counter = 0;
+    uint64_t counter = __atomic_add_fetch( &creation_counter, 1, __ATOMIC_RELAXED );
 
-    // Seed Xoshiro128+.
-    s[0] = tinymt64_generate_uint64( p_prng_init );
-    s[1] = tinymt64_generate_uint64( p_prng_init );
-
-    free( p_prng_init );
-    s_seeded = 1;
+    return (  ( ((uint64_t)hi << 32) | lo ) ^ (counter * 0x9E3779B97F4A7C15ULL)  );
 }
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 
-static uint64_t topow( uint64_t a, uint64_t b ) {
-    uint64_t r = a;
-    for ( uint64_t x = 1; x < b; x++ )  r *= a;
-    return r;
+// Render an unsigned value in the given base, zero-padded to 'width' characters
+//   (0 = natural width), into the caller's scratch buffer. No printf, no heap.
+//   Returns the rendered length. The caller guarantees the buffer can hold the
+//   widest permitted field (22 octal digits) plus padding and a terminator.
+static size_t __render_uint(
+    char* p_out,
+    unsigned long long int val,
+    unsigned int base,
+    int upper,
+    unsigned short width
+) {
+    static const char lower_digits[] = "0123456789abcdef";
+    static const char upper_digits[] = "0123456789ABCDEF";
+    const char* p_digits = upper ? upper_digits : lower_digits;
+
+    // Digits come out backward; stage them and reverse on the copy.
+    char tmp[24];
+    size_t n = 0;
+
+    do {
+        tmp[n++] = p_digits[val % base];
+        val /= base;
+    } while ( val && n < sizeof(tmp) );
+
+    size_t pad = ( width > n ) ? (width - n) : 0;
+    for ( size_t i = 0; i < pad; i++ )  *(p_out+i) = '0';
+    for ( size_t i = 0; i < n; i++ )    *(p_out+pad+i) = tmp[n-1-i];
+    *(p_out+pad+n) = '\0';
+
+    return (pad + n);
 }
 
 
 
-// Create a new generator context for re/use to make string generation faster.
-fuzz_gen_ctx_t* Generator__new_context( fuzz_factory_t* p_factory ) {
-    if ( NULL == p_factory )  return NULL;
+// Re-seed a context's PRNG. The 64-bit seed is expanded through splitmix64 into
+//   the full 128-bit Xoshiro state, per the generator author's recommendation.
+//   Subcontext child generators get well-separated (golden-ratio-strided) streams
+//   derived from the same seed, so the whole context tree is reproducible.
+void Generator__seed_context( fuzz_gen_ctx_t* p_ctx, uint64_t seed ) {
+    if ( NULL == p_ctx )  return;
+
+    uint64_t sm = seed;
+    p_ctx->seed = seed;   //recorded so (seed, iteration) coordinates can be captured
+    p_ctx->prng[0] = splitmix64_next( &sm );
+    p_ctx->prng[1] = splitmix64_next( &sm );
+
+    for ( size_t i = 0; i < p_ctx->p_factory->subcontexts_count; i++ ) {
+        // Interned slots alias a canonical slot's child; seed the shared child once.
+        if ( i != (p_ctx->p_factory->subcontexts[i]).intern_of )
+            continue;
+
+        Generator__seed_context(
+            (p_ctx->sub_states[i]).p_gen_ctx,
+            (seed + ((i + 1) * 0x9E3779B97F4A7C15ULL))
+        );
+    }
+}
 
-    // Seed the static PRNG if it hasn't been done yet. This will only happen a single time,
-    //   even if the application is running in threaded mode.
-    if ( 0 == s_seeded )
-        Xoshiro128p__init();
+
+// Shared construction core. 'owns_factory' marks whether deleting the context also
+//   deletes the (otherwise shared, immutable) factory underneath it.
+static fuzz_gen_ctx_t* __Generator__new_context(
+    fuzz_factory_t* p_factory, uint64_t seed, int owns_factory
+) {
+    if ( NULL == p_factory )  return NULL;
 
     // Create the generator context and return it.
     fuzz_gen_ctx_t* x = (fuzz_gen_ctx_t*)calloc( 1, sizeof(fuzz_gen_ctx_t) );
     x->p_factory = p_factory;
-    x->p_data_pool = (unsigned char*)calloc( 1, (sizeof(unsigned char)*(p_factory->max_output_size))+1 );
+    x->owns_factory = owns_factory;
+
+    // The data pool is a lazy anonymous mapping rather than an eager calloc: the
+    //   worst-case max_output_size for nested repetitions can run to gigabytes, so
+    //   MAP_NORESERVE reserves only address space and physical pages fault in as
+    //   generation actually touches them. Typical patterns never dirty more than
+    //   a few pages of it.
+    size_t page = (size_t)sysconf( _SC_PAGESIZE );
+    x->pool_size = ( ((p_factory->max_output_size) + 2 + page - 1) / page ) * page;
+    x->pool_resident = 0;
+    x->pool_prefix_resident = 0;
+
+    x->p_data_pool = (unsigned char*)mmap( NULL, x->pool_size,
+        (PROT_READ | PROT_WRITE), (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE), -1, 0 );
+    if ( MAP_FAILED == x->p_data_pool ) {
+        free( x );
+        return NULL;
+    }
+
     x->p_pool_end = (
         2
         + (x->p_data_pool)
@@ -107,18 +382,89 @@ fuzz_gen_ctx_t* Generator__new_context( fuzz_factory_t* p_factory ) {
     memset( &((x->state).counter[0]), 0, sizeof(fuzz_gen_ctx_counter_t)*FUZZ_MAX_NESTING_COMPLEXITY );
     (x->state).nest_level = 0;
 
+    // Build this context's own child generators over the factory's shared,
+    //   read-only sub-factories. Scratch slabs stay lazy (see shuffle below).
+    //   Interned slots share their canonical slot's child generator outright:
+    //   sub-generation writes into the per-slot scratch slab, so the child is
+    //   pure interpreter state and one instance (one data pool, one PRNG
+    //   stream) serves every variable compiled to the same program.
+    for ( size_t i = 0; i < p_factory->subcontexts_count; i++ ) {
+        size_t canon = (p_factory->subcontexts[i]).intern_of;
+
+        if ( canon < i ) {
+            (x->sub_states[i]).p_gen_ctx = (x->sub_states[canon]).p_gen_ctx;
+            continue;
+        }
+
+        (x->sub_states[i]).p_gen_ctx = __Generator__new_context(
+            (p_factory->subcontexts[i]).p_factory, 0, 0 );
+
+        if ( NULL == (x->sub_states[i]).p_gen_ctx ) {
+            Generator__delete_context( x );
+            return NULL;
+        }
+    }
+
+    // Seed last so the derived subcontext streams land in the fresh children.
+    Generator__seed_context( x, seed );
+
     return x;
 }
 
 
-// Deletes any allocated gen ctx resources, but not 'deeply'. Also deletes
-//   the attached pattern factory and all of its resources.
+// Create a new generator context for re/use to make string generation faster.
+//   The PRNG stream is seeded randomly; use the _seeded variant to reproduce runs.
+fuzz_gen_ctx_t* Generator__new_context( fuzz_factory_t* p_factory ) {
+    return __Generator__new_context( p_factory, Xoshiro128p__random_seed(), 1 );
+}
+
+
+// Create a new generator context whose PRNG stream is fully determined by 'seed'.
+fuzz_gen_ctx_t* Generator__new_context_seeded( fuzz_factory_t* p_factory, uint64_t seed ) {
+    return __Generator__new_context( p_factory, seed, 1 );
+}
+
+
+// Clone a context over the same compiled factory: all mutable state (pool, PRNG,
+//   counters, subcontext scratch) is private to the clone, while the read-only
+//   program stays shared -- so N threads never duplicate the parsed pattern.
+fuzz_gen_ctx_t* Generator__clone_context( fuzz_gen_ctx_t* p_ctx ) {
+    if ( NULL == p_ctx )  return NULL;
+
+    return __Generator__new_context( p_ctx->p_factory, Xoshiro128p__random_seed(), 0 );
+}
+
+
+// Deletes any allocated gen ctx resources, including its subcontext child
+//   generators and scratch slabs. The attached pattern factory is only deleted
+//   when this context owns it (i.e. it is not a clone or a child).
 void Generator__delete_context( fuzz_gen_ctx_t* p_ctx ) {
     if ( NULL != p_ctx ) {
-        free( p_ctx->p_data_pool );
+        for ( size_t i = 0; i < FUZZ_MAX_SUBCONTEXTS; i++ ) {
+            // Interned slots only borrow the canonical slot's child generator.
+            int borrowed = (
+                   NULL != p_ctx->p_factory
+                && i < p_ctx->p_factory->subcontexts_count
+                && i != (p_ctx->p_factory->subcontexts[i]).intern_of
+            );
+
+            if ( !borrowed )
+                Generator__delete_context( (p_ctx->sub_states[i]).p_gen_ctx );
+            (p_ctx->sub_states[i]).p_gen_ctx = NULL;
+
+            if ( NULL != (p_ctx->sub_states[i]).p_most_recent ) {
+                // The scratch is one slab: the header and its payload together.
+                free( (void*)(p_ctx->sub_states[i]).p_most_recent );
+                (p_ctx->sub_states[i]).p_most_recent = NULL;
+            }
+        }
+
+        if ( NULL != p_ctx->p_data_pool )
+            munmap( p_ctx->p_data_pool, p_ctx->pool_size );
         p_ctx->p_data_pool = NULL;
 
-        PatternFactory__delete( p_ctx->p_factory );
+        if ( p_ctx->owns_factory )
+            PatternFactory__delete( p_ctx->p_factory );
         p_ctx->p_factory = NULL;
 
         free( p_ctx );
@@ -127,68 +473,178 @@ void Generator__delete_context( fuzz_gen_ctx_t* p_ctx ) {
 
 
 
-// Generate a new fuzzer output string.
-//   In this function, SPEED IS ESSENTIAL to maximize throughput.
-// TODO: At the end of gen, check the shards list contexts and free all current fuzz_str_t objects from each.
-//   This must only apply to sub-factories and not the parent context since the fuzz_str_t from the parent
-//   might be used anywhere and needs to be freed by the implementer.
-fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
-    if ( NULL == p_ctx )  return NULL;
+static long long int __Generator__generate(
+    fuzz_gen_ctx_t* p_ctx, unsigned char* p_buf, unsigned char* p_limit,
+    fuzz_sink_fn p_sink, void* p_sink_arg );
+
+// Re/generate a subcontext's scratch output in place. Every sub-state owns ONE
+//   slab for its whole lifetime -- a fuzz_str_t header with the payload laid out
+//   directly behind it, sized off the sub-factory's max output size -- so the old
+//   churn of freeing and reallocating a p_most_recent pair per shuffle is gone
+//   and this path never touches the heap after first use. Returns the refreshed
+//   header, or NULL when the sub-generation faults.
+static fuzz_str_t* __Generator__shuffle_subcontext( fuzz_sub_state_t* p_substate ) {
+    fuzz_gen_ctx_t* p_gctx = p_substate->p_gen_ctx;
+    if ( NULL == p_gctx )  return NULL;
+
+    size_t payload_size = (p_gctx->p_factory->max_output_size + 2);
 
+    fuzz_str_t* p_slab = p_substate->p_most_recent;
+    if ( NULL == p_slab ) {
+        p_slab = (fuzz_str_t*)calloc( 1, sizeof(fuzz_str_t) + payload_size );
+        if ( NULL == p_slab )  return NULL;
+
+        p_slab->output = (const void*)(p_slab + 1);
+        p_substate->p_most_recent = p_slab;
+    }
+
+    unsigned char* p_payload = (unsigned char*)(p_slab + 1);
+    long long int len = __Generator__generate(
+        p_gctx, p_payload, (p_payload + payload_size), NULL, NULL );
+    if ( len < 0 ) {
+        p_slab->length = 0;
+        *(p_payload) = '\0';
+        return NULL;
+    }
+
+    p_slab->length = len;
+    *(p_payload + len) = '\0';
+    return p_slab;
+}
+
+
+
+// Run the generator's interpreter loop ONCE, writing the output bytes directly into
+//   the buffer given by the caller (bounded by 'p_limit'). Returns the generated
+//   length, or -1 when generation overflows the buffer or otherwise faults.
+//   This is the hot core shared by the single-shot and batched entry points.
+//   With a non-NULL 'p_sink', the buffer instead acts as a bounded streaming
+//   window: whenever a write would cross 'p_limit' the filled front is flushed to
+//   the sink and the cursor rewinds, so output length is no longer bounded by the
+//   buffer. Nothing in the instruction set ever writes BEHIND the cursor (variable
+//   payloads live in their own scratch slabs, and length fields read those slabs,
+//   not the pool), which is what makes flush-and-rewind safe with no back-patching.
+static long long int __Generator__generate(
+    fuzz_gen_ctx_t* p_ctx,
+    unsigned char* p_buf,
+    unsigned char* p_limit,
+    fuzz_sink_fn p_sink,
+    void* p_sink_arg
+) {
     fuzz_pattern_block_t* pip;   // aka "pseudo-instruction-pointer"
     unsigned char* p_current;
     fuzz_gen_ctx_counter_t* p_nullified = NULL;   // tracks subsequences with 0 iters--nullifies all inside contents
+    unsigned long long int flushed = 0;   // bytes already handed to the sink (streaming only)
 
     pip = (fuzz_pattern_block_t*)(p_ctx->p_factory->node_seq);
-    p_current = p_ctx->p_data_pool;
+    p_current = p_buf;
+
+    // Direct-threaded dispatch: every block type maps straight to its handler label
+    //   below, and each handler jumps back here for the next instruction. The whole
+    //   program is one contiguous fixed-width array, so there is no switch overhead
+    //   and no per-block pointer chase for inline operands.
+    static const void* const __dispatch[] = {
+        [0]           = &&__op_bad,
+        [reference]   = &&__op_reference,
+        [string]      = &&__op_string,
+        [range]       = &&__op_range,
+        [sub]         = &&__op_sub,
+        [ret]         = &&__op_ret,
+        [branch_root] = &&__op_branch_root,
+        [branch_jmp]  = &&__op_branch_jmp,
+        [end]         = &&__gen_done
+    };
+
+    size_t iters;
 
     // Let's do it, but play nicely.
     //printf( "\n=== [Nest] [Null?] [Type] [Count] ===\n" );
     void* p_instruction_limit =
-        (void*)pip + (p_ctx->p_factory->count * sizeof(fuzz_factory_t));
+        (void*)pip + (p_ctx->p_factory->count * sizeof(fuzz_pattern_block_t));
+
+    // Constant-prefix fast path: the compiler pre-rendered the program's
+    //   deterministic front, so land it with ONE copy and enter the interpreter
+    //   at the first variable block. Runs targeting the context's own pool skip
+    //   even the copy when the prefix bytes are still resident from the last run.
+    if ( p_ctx->p_factory->const_prefix_len > 0 ) {
+        size_t prefix_len = p_ctx->p_factory->const_prefix_len;
+
+        if (  p_buf == p_ctx->p_data_pool && p_ctx->pool_prefix_resident >= prefix_len  ) {
+            p_current += prefix_len;   //bytes are already in place from the previous run
+        } else if (  ((sizeof(char)*prefix_len)+p_current) < p_limit  ) {
+            memcpy( p_current, p_ctx->p_factory->p_const_prefix, prefix_len );
+            p_current += prefix_len;
+        } else {
+            p_current = __Generator__stream_repeat( p_current, p_buf, p_limit,
+                p_ctx->p_factory->p_const_prefix, prefix_len, 1, p_sink, p_sink_arg, &flushed );
+            if ( NULL == p_current )  goto __gen_overflow;
+        }
+
+        // A flush rewound the window over the prefix bytes; otherwise pool-front
+        //   runs can hand them to the next generation for free.
+        if ( p_buf == p_ctx->p_data_pool )
+            p_ctx->pool_prefix_resident = ( 0 == flushed ) ? prefix_len : 0;
+
+        pip += p_ctx->p_factory->const_resume_index;
+    }
+
+    __gen_dispatch: {
+        if ( NULL == pip || (void*)pip >= p_instruction_limit )
+            goto __gen_done;
+
+        // Corrupted/unknown types must never index past the dispatch table.
+        if ( (unsigned)pip->type > (unsigned)end )
+            goto __op_bad;
 
-    while ( pip && end != pip->type && (void*)pip < p_instruction_limit ) {
         // If the current state has a nullified pointer set and the type isn't a ret or sub, keep moving.
         if (  sub != pip->type && ret != pip->type && NULL != p_nullified  ) {
             pip++;
-            continue;
+            goto __gen_dispatch;
         }
 
-        size_t processed = 0;
-
         // The number of iterations selected will either be a single value,
         //   or a number from a range of values. Hold onto your pants...
-        size_t iters =
+        iters =
             (  ((pip->count).single > 0) * (pip->count).base  )
             + (
                 ((pip->count).single < 1)
-                  * ( Xoshiro128p__next_bounded( (pip->count).base, (pip->count).high ) )
+                  * ( Xoshiro128p__next_bounded( &(p_ctx->prng[0]), (pip->count).base, (pip->count).high ) )
             );
 
         // Helpful debugging information.
         //printf( "[N: %lu] [X: %u] [T: %u] [C: %5lu]\n", (p_ctx->state).nest_level, (NULL != p_nullified), pip->type, iters );
 
-        // The block type must determine the next behavior used in pattern generation.
-        switch ( pip->type ) {
+        // Executed-instruction accounting: one plain increment per dispatched block.
+        //   This context is single-threaded, so no atomics are needed here.
+        ( (p_ctx->stats).block_executions[pip->type] )++;
+
+        // The block type determines the next behavior used in pattern generation.
+        goto *__dispatch[pip->type];
+    }
 
-            case reference : {
-                fuzz_reference_t* p_ref = (fuzz_reference_t*)(pip->data);
+            __op_reference : {
+                fuzz_reference_t* p_ref = pip->operand.p_ref;
 
-                fuzz_subcontext_t* p_subctx = PatternFactory__get_subcontext(
-                    p_ctx->p_factory, &(p_ref->label[0]) );
+                // The subcontext slot was resolved when the factory was built; the
+                //   sentinel means the label never got a declaration. Big problem.
+                if ( p_ref->subctx_index >= p_ctx->p_factory->subcontexts_count )
+                    goto __gen_overflow;
 
-                // If the gen ctx couldn't be found for the label, break out. This would be a big problem.
-                if ( NULL == p_subctx )  goto __gen_overflow;
+                // Mutable subcontext state belongs to THIS context; the factory's
+                //   table only carries the shared, read-only sub-factory.
+                fuzz_sub_state_t* p_substate =
+                    &(p_ctx->sub_states[p_ref->subctx_index]);
 
                 // Either get the most recent or generate if there is no most-recent.
                 int was_regen = 0;
-                fuzz_str_t* p_new_data = NULL;
-                fuzz_str_t* p_str = (fuzz_str_t*)(p_subctx->p_most_recent);
+                fuzz_str_t* p_str = p_substate->p_most_recent;
                 if ( NULL == p_str ) {
-                    // Hasn't been shuffled yet; generate the first item in the sub-factory.
-                    p_new_data = Generator__get_next( (fuzz_gen_ctx_t*)(p_subctx->p_gen_ctx) );
-                    p_str = p_new_data;
+                    // Hasn't been shuffled yet; generate the first item into the
+                    //   subcontext's persistent scratch slab.
+                    p_str = __Generator__shuffle_subcontext( p_substate );
                     was_regen = 1;
+
+                    if ( NULL == p_str )  goto __gen_overflow;
                 }
 
                 switch ( p_ref->type ) {
@@ -199,13 +655,13 @@ fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
                         unsigned long long int z = p_str->length;
 
                         // Mindful of overflows.
-                        if ( ((sizeof(char)*iters*z)+p_current) >= p_ctx->p_pool_end )
-                            goto __gen_overflow;
-
-                        // Write the stream.
-                        for ( ; processed < iters; processed++ ) {
-                            memcpy( p_current, p_str->output, z );
-                            p_current += z;
+                        if ( ((sizeof(char)*iters*z)+p_current) < p_limit ) {
+                            // Write the stream, doubling the filled region as it grows.
+                            p_current = __Generator__fill_repeat( p_current, p_str->output, z, iters );
+                        } else {
+                            p_current = __Generator__stream_repeat( p_current, p_buf, p_limit,
+                                p_str->output, z, iters, p_sink, p_sink_arg, &flushed );
+                            if ( NULL == p_current )  goto __gen_overflow;
                         }
 
                         break;
@@ -220,61 +676,35 @@ fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
                         long long int add = (p_ref->lenopts).add;
                         len += add;   //just do this now.
 
-                        char* p_len = (char*)calloc( 96, sizeof(char) );   //96 is arbitrary but it needs to be higher than 64
-                        if ( NULL == p_len ) {
-                            goto __gen_overflow;
-                        }
+                        // Stack scratch: the widest field is 22 octal digits, so no
+                        //   heap round-trips or printf calls happen on this path.
+                        char p_len[96];
 
                         // NOTE: If a width is specified and the string overflows that width, the value will overflow back to 0.
                         //        For now this is intended behavior, but may want to alter this to max out instead.
                         if (  raw_little != (p_ref->lenopts).type && raw_big != (p_ref->lenopts).type  ) {
-                            char* p_fmt = (char*)calloc( 16, sizeof(char) );
-                            if ( NULL == p_fmt ) {
-                                free( p_fmt );
-                                goto __gen_overflow;
-                            }
-
-                            char base_code = 0;
-                            unsigned short width_multiplier = 0;
+                            // Apply the wrap modulus precompiled at parse time.
+                            if ( 0 != (p_ref->lenopts).wrap )
+                                len %= (p_ref->lenopts).wrap;
 
                             switch ( (p_ref->lenopts).type ) {
-                                case binary      : {  base_code = 'b'; width_multiplier = 1;  break;  }
-                                case decimal     : {  base_code = 'd'; width_multiplier = 10; break;  }
-                                case hexadecimal : {  base_code = 'x'; width_multiplier = 4;  break;  }
-                                case hex_upper   : {  base_code = 'X'; width_multiplier = 4;  break;  }
-                                case octal       : {  base_code = 'o'; width_multiplier = 3;  break;  }
-                                // do NOT guess on the len type, just crash
-                                default          : {  free( p_fmt ); free( p_len ); goto __gen_overflow;  }
-                            }
-
-                            if ( width > 0 ) {
-
-                                if ( (width_multiplier*width) < 64 ) {
-                                    len %= ( decimal == (p_ref->lenopts).type )
-                                        ? (topow(10, width))
-                                        : (1UL << (width_multiplier*width));
-                                }
-
-                                if ( binary != (p_ref->lenopts).type ) {
-                                    sprintf( p_fmt, "%%0%hull%c", width, base_code );
-                                } else {
+                                case binary : {
+                                    // Parser enforces 1 <= width <= 64 for binary fields.
                                     char* p_x = p_len;
                                     for ( unsigned short x = width; x > 0; x--, p_x++ ) {
                                         *(p_x) = ((len & (1UL<<(x-1))) ? '1' : '0');
                                     }
+                                    *p_x = '\0';
+                                    step_length = width;
+                                    break;
                                 }
-                            } else {
-                                sprintf( p_fmt, "%%ll%c", base_code );
-                            }
-
-                            // Use the generated format-string to create the resulting length output.
-                            if ( binary != (p_ref->lenopts).type ) {
-                                snprintf ( p_len, 96, p_fmt, len );
+                                case decimal     : {  step_length = __render_uint( p_len, len, 10, 0, width );  break;  }
+                                case hexadecimal : {  step_length = __render_uint( p_len, len, 16, 0, width );  break;  }
+                                case hex_upper   : {  step_length = __render_uint( p_len, len, 16, 1, width );  break;  }
+                                case octal       : {  step_length = __render_uint( p_len, len, 8,  0, width );  break;  }
+                                // do NOT guess on the len type, just crash
+                                default          : {  goto __gen_overflow;  }
                             }
-                            *(p_len+95) = '\0';   //paranoia
-
-                            free( p_fmt );
-                            step_length = strlen( p_len );
 
                         } else {
                             // The type is 'raw'. In this case, we do a direct write to the memory at 'p_len'
@@ -285,115 +715,101 @@ fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
                         }
 
                         // Muh overflow.
-                        if ( ((sizeof(char)*iters*step_length)+p_current) >= p_ctx->p_pool_end ) {
-                            free( p_len );
-                            goto __gen_overflow;
-                        }
-
-                        // Copy the string to the pool for the indicated number of iterations.
-                        for ( ; processed < iters; processed++ ) {
-                            memcpy( p_current, p_len, step_length );
-                            p_current += step_length;
+                        if ( ((sizeof(char)*iters*step_length)+p_current) < p_limit ) {
+                            // Copy the rendered field to the pool for every iteration.
+                            p_current = __Generator__fill_repeat( p_current, p_len, step_length, iters );
+                        } else {
+                            p_current = __Generator__stream_repeat( p_current, p_buf, p_limit,
+                                p_len, step_length, iters, p_sink, p_sink_arg, &flushed );
+                            if ( NULL == p_current )  goto __gen_overflow;
                         }
 
-                        free( p_len );
                         break;
                     }
 
                     case ref_shuffle : {
-                        // When regenerating the pattern, make sure to free the old subfactory resource.
-                        //   If this is already a fresh shuffle, don't do anything (saves time).
+                        // Regenerate the subcontext's slab in place. If this reference
+                        //   already shuffled fresh above, don't do it again (saves time).
                         // NOTE: This ignores the 'iters' value to save time. Only one shuffle at a time.
-                        if ( !was_regen ) {
-                            if ( NULL != p_subctx->p_most_recent ) {
-                                free( (void*)(((fuzz_str_t*)(p_subctx->p_most_recent))->output) );
-                                free( p_subctx->p_most_recent );
-                                p_subctx->p_most_recent = NULL;
-                            }
-
-                            p_new_data = Generator__get_next( (fuzz_gen_ctx_t*)(p_subctx->p_gen_ctx) );
-                            was_regen = 1;
-                        }
+                        if ( !was_regen && NULL == __Generator__shuffle_subcontext( p_substate ) )
+                            goto __gen_overflow;
                         break;
                     }
 
                     default : break;   // if this somehow happens, do nothing; just move on
                 }
 
-                // If the data for the subctx was regenerated, free the old data and replace the pointer.
-                if ( was_regen && NULL != p_new_data ) {
-                    fuzz_str_t* p_old_data = (fuzz_str_t*)(p_subctx->p_most_recent);
-
-                    if ( NULL != p_old_data )
-                        free( (void*)(p_old_data->output) );
-                    free( p_old_data );
-
-                    p_subctx->p_most_recent = p_new_data;
-                }
-
                 // Move to the next block. References do not loop.
                 pip++;
-                break;
+                goto __gen_dispatch;
             }
 
-            case string : {
-                // Catalog the length of the incoming static string. NOTE: \x00 are NOT allowed in static
-                //   string block types (only ranges), so using a strxyz function is valid.
-                size_t z = strlen( (char*)(pip->data) );
+            __op_string : {
+                // The string's length was cached at parse time in the inline operand, so
+                //   no strlen scan happens per generation.
+                size_t z = pip->operand.str.length;
 
                 // Mindful of overflows.
-                if ( ((sizeof(char)*iters*z)+p_current) >= p_ctx->p_pool_end )  goto __gen_overflow;
-
-                // Write the string.
-                for ( ; processed < iters; processed++ ) {
-                    memcpy( p_current, (char*)(pip->data), z );
-                    p_current += z;
+                if ( ((sizeof(char)*iters*z)+p_current) < p_limit ) {
+                    // Write the string, doubling the filled region as it grows.
+                    p_current = __Generator__fill_repeat( p_current, pip->operand.str.p_str, z, iters );
+                } else {
+                    p_current = __Generator__stream_repeat( p_current, p_buf, p_limit,
+                        pip->operand.str.p_str, z, iters, p_sink, p_sink_arg, &flushed );
+                    if ( NULL == p_current )  goto __gen_overflow;
                 }
 
                 // Move to the next block.
                 pip++;
-                break;
+                goto __gen_dispatch;
             }
 
-            case range : {
-                // Overflow check boi
-                if ( ((sizeof(char)*iters)+p_current) >= p_ctx->p_pool_end )  goto __gen_overflow;
-
+            __op_range : {
                 // Get the range object.
-                fuzz_range_t* p_range = ((fuzz_range_t*)(pip->data));
+                fuzz_range_t* p_range = pip->operand.p_range;
 
-                // If the range has useable fragments, use the PRNG to get a character from one of them.
-                if ( p_range && p_range->amount > 0 ) {
-                    fuzz_repetition_t* p_frag = &(p_range->fragments[0]);
-                    fuzz_repetition_t* p_select;
-
-                    // Loop over the range to get a random byte <iters> times.
-                    for ( ; processed < iters; processed++ ) {
-                        uint8_t frag_select = (uint8_t)Xoshiro128p__next_bounded( 0, ((p_range->amount)-1) );
-
-                        p_select = (p_frag + frag_select);
-
-                        uint8_t char_select;
-                        if ( 0 != p_select->single ) {
-                            char_select = p_select->base;
-                        } else {
-                            char_select = (uint8_t)Xoshiro128p__next_bounded( p_select->base, p_select->high );
+                // Overflow check boi
+                if ( ((sizeof(char)*iters)+p_current) < p_limit ) {
+                    // If the range has useable fragments, run the bulk sampling kernel
+                    //   over its precomputed table to emit all <iters> bytes at once.
+                    if ( p_range && p_range->amount > 0 )
+                        p_current += __Generator__fill_range( &(p_ctx->prng[0]), p_range, p_current, iters );
+                } else if ( NULL == p_sink ) {
+                    goto __gen_overflow;
+                } else if ( p_range && p_range->amount > 0 ) {
+                    // Streamed run: sample the bytes window-sized chunks at a time,
+                    //   flushing between them. The carried word keeps the chunked
+                    //   draws identical to one continuous fill of the whole run.
+                    fuzz_range_carry_t carry = { 0, 0 };
+
+                    for ( size_t remaining = iters; remaining > 0; ) {
+                        size_t space = (size_t)(p_limit - p_current);
+                        size_t chunk = (space > 0) ? (space - 1) : 0;
+
+                        if ( 0 == chunk ) {
+                            if ( !__Generator__stream_flush( p_buf, &p_current, p_sink, p_sink_arg, &flushed ) )
+                                goto __gen_overflow;
+                            continue;
                         }
 
-                        // Copy the selected character onto the output pool and increment.
-                        *(p_current) = (unsigned char)char_select;
-                        p_current++;
+                        if ( chunk > remaining )  chunk = remaining;
+                        p_current += __Generator__fill_range_carry(
+                            &(p_ctx->prng[0]), p_range, p_current, chunk, &carry );
+                        remaining -= chunk;
                     }
                 }
 
                 // Move to the next block.
                 pip++;
-                break;
+                goto __gen_dispatch;
             }
 
-            case sub : {
-                // Get the pointer to the counter for the current nest level.
+            __op_sub : {
+                // Get the pointer to the counter for the current nest level. Depth
+                //   past the compile-time ceiling can only come from a corrupted
+                //   program; never index beyond the counter array.
                 size_t* lvl = &((p_ctx->state).nest_level);
+                if ( *lvl >= FUZZ_MAX_NESTING_COMPLEXITY )  goto __gen_overflow;
                 fuzz_gen_ctx_counter_t* p_ctr = &((p_ctx->state).counter[*lvl]);
                 if ( NULL == p_ctr )  goto __gen_overflow;
 
@@ -411,12 +827,14 @@ fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
                 // Increase the nest level and move to the next block.
                 *lvl = (*lvl)+1;
                 pip++;
-                break;
+                goto __gen_dispatch;
             }
 
-            case ret : {
-                // Get the pointer to the counter for the __PREVIOUS__ (outer) nest level.
+            __op_ret : {
+                // Get the pointer to the counter for the __PREVIOUS__ (outer) nest
+                //   level. A 'ret' with no open 'sub' would index counter[-1].
                 size_t* lvl = &((p_ctx->state).nest_level);
+                if ( *lvl < 1 )  goto __gen_overflow;
                 fuzz_gen_ctx_counter_t* p_ctr = &((p_ctx->state).counter[*lvl - 1]);
                 if ( NULL == p_ctr )  goto __gen_overflow;
 
@@ -439,52 +857,129 @@ fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
                 if ( UINT16_MAX != p_ctr->generated && p_ctr->generated < p_ctr->how_many ) {
                     // Back the pip back to where it needs to be (we blindly trust it)
                     //   and increase the generator count.
-                    pip -= *((size_t*)(pip->data));
+                    pip -= pip->operand.step;
                 } else {
                     // The sub is over. Decrease the nest level and continue.
                     __gen_ret_step_out:
                     *lvl = (*lvl)-1;
                     pip++;
                 }
-                break;
+                goto __gen_dispatch;
             }
 
-            case branch_root : {
+            __op_branch_root : {
                 // Randomly select one of the available branches from the structure.
-                fuzz_branch_root_t* p_root = (fuzz_branch_root_t*)(pip->data);
+                fuzz_branch_root_t* p_root = pip->operand.p_branch;
 
                 // If for some reason the root is null, proceed to the next instruction
                 //   so the branch falls back to the first choice on error.
                 if ( NULL == p_root ) {
                     pip++;
-                    break;
+                    goto __gen_dispatch;
                 }
 
                 // Get the random index into the steps table and select it.
-                size_t select = Xoshiro128p__next_bounded( 0, p_root->amount );
+                size_t select = Xoshiro128p__next_bounded( &(p_ctx->prng[0]), 0, p_root->amount );
+
+                // Weighted roots resolve through the parse-time Walker alias table:
+                //   one more draw either keeps the uniform column or redirects to
+                //   its alias. Two table reads, O(1) for any alternative count.
+                if ( p_root->weighted
+                    && Xoshiro128p__next( &(p_ctx->prng[0]) ) >= p_root->accept[select] )
+                    select = p_root->alias[select];
 
                 unsigned short incr = p_root->steps[select];
                 pip += (incr ? incr : 1);   //always move by at least 1
-                break;
+                goto __gen_dispatch;
             }
-            case branch_jmp : {
+            __op_branch_jmp : {
                 // Blindly follow the jump, moving the pseudo instruction ptr (PIP) forward.
-                size_t jmp = *((size_t*)(pip->data));
+                size_t jmp = pip->operand.step;
                 pip += (jmp ? jmp : 1);   //by at least 1 so it doesn't get stuck
-                break;
+                goto __gen_dispatch;
             }
 
-            default : {
-                return NULL;   // TODO: should this be here?
-                break;
+            __op_bad : {
+                goto __gen_overflow;   // TODO: should this be here?
             }
 
-        }
+    __gen_done: {
+        // Streamed runs hand any remaining tail to the sink so the caller always
+        //   sees the complete output before this returns.
+        if ( NULL != p_sink
+            && !__Generator__stream_flush( p_buf, &p_current, p_sink, p_sink_arg, &flushed ) )
+            goto __gen_overflow;
+
+        // Return the amount of content generated into the buffer, tracking the
+        //   completed run's throughput counters and the pool high-water mark.
+        unsigned long long int len = flushed + (unsigned long long int)(p_current - p_buf);
+
+        ( (p_ctx->stats).outputs_generated )++;
+        (p_ctx->stats).bytes_generated += len;
+        if ( len > (p_ctx->stats).pool_high_water )
+            (p_ctx->stats).pool_high_water = len;
+
+        return (long long int)len;
+    }
+
+
+    __gen_overflow:
+        // When a generator buffer is going to overflow, STOP and RESET!
+        //   This can also occur on other types of faults, so -1 is returned to indicate a
+        //   failure to generate patterned content.
+        (p_ctx->state).nest_level = 0;   //reset on overflow
+        ( (p_ctx->stats).overflow_events )++;
+
+        // Return -1 to indicate crashy conditions.
+        return -1;
+}
+
+
+
+// Track the pool's touched footprint and advise outlier pages back to the kernel.
+//   After a run that dirtied only a small fraction of a large resident high-water
+//   mark, the excess pages are handed to MADV_FREE: the kernel reclaims them only
+//   under memory pressure, and re-faulting later costs no more than first touch.
+static void __Generator__trim_pool( fuzz_gen_ctx_t* p_ctx, size_t used ) {
+    used += 2;   //cover the trailing scrub/NULL bytes behind the output
+
+    if ( used >= p_ctx->pool_resident ) {
+        p_ctx->pool_resident = used;
+        return;
+    }
+
+    // Only trim when the footprint is large AND this run used a small fraction
+    //   of it; a steady stream of big outputs must not thrash madvise calls.
+    if (  p_ctx->pool_resident < FUZZ_POOL_TRIM_THRESHOLD
+        || used > (p_ctx->pool_resident / 8)  )
+        return;
+
+    size_t page = (size_t)sysconf( _SC_PAGESIZE );
+    size_t keep = ( (used + page - 1) / page ) * page;
+
+    if ( keep < p_ctx->pool_size )
+        madvise( (p_ctx->p_data_pool + keep), (p_ctx->pool_size - keep), MADV_FREE );
+
+    p_ctx->pool_resident = used;
+}
+
+
+// Generate a new fuzzer output string.
+//   In this function, SPEED IS ESSENTIAL to maximize throughput.
+fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
+    if ( NULL == p_ctx )  return NULL;
+
+    long long int len = __Generator__generate( p_ctx, p_ctx->p_data_pool, p_ctx->p_pool_end, NULL, NULL );
+    if ( len < 0 ) {
+        // The failed run's partial bytes can stay: every later run overwrites the
+        //   exact span it reports, so nothing stale is ever copied out. Scrubbing
+        //   the whole worst-case pool here used to be a multi-GB memset.
+        return NULL;
     }
 
     // Allocate a COPY of the return data and return the struct ptr.
     fuzz_str_t* p_ret = (fuzz_str_t*)calloc( 1, sizeof(fuzz_str_t) );
-    p_ret->length = (p_current - p_ctx->p_data_pool);
+    p_ret->length = len;
 
     if ( p_ret->length > 0 ) {
         p_ret->output = (const void*)calloc( (p_ret->length + 1), sizeof(char) );
@@ -496,41 +991,155 @@ fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx ) {
         p_ret->output = NULL;
     }
 
-    // Clear the data pool for the next generation.
-    memset( p_ctx->p_data_pool, 0, (p_ret->length + 1) );
+    // Clear the data pool for the next generation and give back outlier pages.
+    //   The baked constant prefix at the pool front stays put so the next run
+    //   can skip re-pasting it.
+    size_t keep = p_ctx->pool_prefix_resident;
+    if ( keep > (size_t)len )  keep = 0;   //paranoia; residency never exceeds the output
+    memset( (p_ctx->p_data_pool + keep), 0, (p_ret->length + 1 - keep) );
+    __Generator__trim_pool( p_ctx, (size_t)len );
 
     // Return the data pointer.
     return p_ret;
+}
 
 
-    __gen_overflow:
-        // When a generator buffer is going to overflow, STOP and RESET!
-        //   This can also occur on other types of faults, so NULL is returned to indicate a
-        //   failure to generate patterned content.
-        memset( p_ctx->p_data_pool, 0, (sizeof(char)*(p_ctx->p_factory->max_output_size)+1) );
-        (p_ctx->state).nest_level = 0;   //reset on overflow
+// Generate the next output and lend the data pool to the caller as a view.
+//   The single trailing NULL byte keeps string-ish outputs printable; no copy-out,
+//   no fresh allocations, and no full-pool memset happen on this path.
+const fuzz_str_t* Generator__peek_next( fuzz_gen_ctx_t* p_ctx ) {
+    if ( NULL == p_ctx )  return NULL;
 
-        // Return NULL to indicate crashy conditions.
-        return NULL;
+    long long int len = __Generator__generate( p_ctx, p_ctx->p_data_pool, p_ctx->p_pool_end, NULL, NULL );
+    if ( len < 0 )  return NULL;   //partial bytes are overwritten by the next run
+
+    *(p_ctx->p_data_pool + len) = '\0';   //only scrub the single byte that matters
+
+    (p_ctx->view).output = (const void*)(p_ctx->p_data_pool);
+    (p_ctx->view).length = len;
+
+    __Generator__trim_pool( p_ctx, (size_t)len );
+
+    return (const fuzz_str_t*)&(p_ctx->view);
+}
+
+
+// Generate 'n' outputs back-to-back into one contiguous arena. Items are packed tightly,
+//   one after the other, with a single NULL byte between them (so string-ish outputs can
+//   still be printed directly). The whole batch--header, records, and arena--is ONE
+//   heap allocation, so allocator traffic stays constant no matter how large 'n' gets.
+fuzz_batch_t* Generator__get_next_n( fuzz_gen_ctx_t* p_ctx, size_t n ) {
+    if ( NULL == p_ctx || n < 1 )  return NULL;
+
+    // The arena must be able to hold the worst case for every item (+1 per item
+    //   for the trailing NULL byte). Carefully check the math for overflows.
+    size_t per_item = (p_ctx->p_factory->max_output_size + 1);
+    size_t arena_size = (n * per_item);
+    if ( (arena_size / n) != per_item )  return NULL;
+
+    size_t records_size = (n * sizeof(fuzz_str_rec_t));
+    size_t total = (sizeof(fuzz_batch_t) + records_size + arena_size);
+    if ( total < arena_size )  return NULL;
+
+    // Like the per-context data pool, the batch is a lazy anonymous mapping: the
+    //   arena is sized for every item's worst case, so reserving address space
+    //   instead of pages keeps huge-max patterns from failing (or dirtying)
+    //   gigabytes up front. Fresh pages arrive zeroed, same as calloc.
+    fuzz_batch_t* p_batch = (fuzz_batch_t*)mmap( NULL, total,
+        (PROT_READ | PROT_WRITE), (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE), -1, 0 );
+    if ( MAP_FAILED == p_batch )  return NULL;
+    p_batch->map_size = total;
+
+    // Carve the single allocation up: [header][records][arena].
+    p_batch->p_records = (fuzz_str_rec_t*)((void*)p_batch + sizeof(fuzz_batch_t));
+    p_batch->p_arena = (unsigned char*)((void*)(p_batch->p_records) + records_size);
+    p_batch->arena_size = arena_size;
+    p_batch->count = 0;
+
+    // Run the interpreter loop back-to-back, each item landing right after the last.
+    unsigned char* p_write = p_batch->p_arena;
+    unsigned char* p_arena_end = (p_batch->p_arena + arena_size);
+
+    for ( size_t i = 0; i < n; i++ ) {
+        long long int len = __Generator__generate( p_ctx, p_write, p_arena_end, NULL, NULL );
+        if ( len < 0 ) {
+            // Whole-batch semantics mirror Generator__get_next: any failure reports NULL.
+            Generator__delete_batch( p_batch );
+            return NULL;
+        }
+
+        (p_batch->p_records[i]).offset = (p_write - p_batch->p_arena);
+        (p_batch->p_records[i]).length = len;
+        p_batch->count++;
+
+        p_write += len;
+        *(p_write++) = '\0';   //calloc zeroed it already, but keep the write explicit
+    }
+
+    return p_batch;
+}
+
+
+// Free a batch. Everything lives in the one mapping, so this is a single munmap.
+void Generator__delete_batch( fuzz_batch_t* p_batch ) {
+    if ( NULL != p_batch )
+        munmap( p_batch, p_batch->map_size );
+}
+
+
+// Stream one output through the caller's sink using a bounded front window of
+//   the data pool. Only the window's pages are ever dirtied, so a pattern whose
+//   worst case is multiple gigabytes generates in constant memory here.
+long long int Generator__get_next_to_sink( fuzz_gen_ctx_t* p_ctx, fuzz_sink_fn p_sink, void* p_arg ) {
+    if ( NULL == p_ctx || NULL == p_sink )  return -1;
+
+    unsigned char* p_window_end = (p_ctx->p_data_pool + FUZZ_STREAM_WINDOW_SIZE);
+    if ( p_window_end > p_ctx->p_pool_end )
+        p_window_end = p_ctx->p_pool_end;
+
+    long long int len = __Generator__generate(
+        p_ctx, p_ctx->p_data_pool, p_window_end, p_sink, p_arg );
+
+    // Any mid-run flush rewound the window over the pool front, so the baked
+    //   prefix can't be trusted to still be sitting there.
+    p_ctx->pool_prefix_resident = 0;
+
+    if ( len < 0 )  return -1;
+
+    // The pool footprint is capped by the window no matter the output length.
+    size_t used = (size_t)(p_window_end - p_ctx->p_data_pool);
+    if ( (unsigned long long int)len < (unsigned long long int)used )
+        used = (size_t)len;
+    __Generator__trim_pool( p_ctx, used );
+
+    return len;
 }
 
 
-// Write the output the an I/O stream directly.
+// fwrite adapter so FILE*-based streaming rides the sink path above.
+static int __Generator__fwrite_sink( const void* p_data, size_t length, void* p_arg ) {
+    return ( fwrite( p_data, sizeof(char), length, (FILE*)p_arg ) == length );
+}
+
+// Write the output the an I/O stream directly. Chunks flow straight from the
+//   streaming window to the stream: the full output is never materialized, so
+//   this no longer needs (or allocates) worst-case-sized memory.
 void Generator__get_next_to_stream( fuzz_gen_ctx_t* p_ctx, FILE* fp_to ) {
 
     if (  !fp_to || ferror( fp_to )  )  return;
 
-    const fuzz_str_t* const p_tmp = Generator__get_next( p_ctx );
-    if ( !p_tmp )  return;
-
-    // Write raw data to the output stream.
-    size_t bytes = fwrite( p_tmp->output, sizeof(char), p_tmp->length, fp_to );
-    if (  !bytes || ferror( fp_to )  )
+    long long int len = Generator__get_next_to_sink( p_ctx, __Generator__fwrite_sink, (void*)fp_to );
+    if (  len < 0 || ferror( fp_to )  )
         fprintf( stderr, "Problem writing raw fuzzer output to the selected stream.\n" );
+}
 
-    // Free the resource.
-    free( (void*)(p_tmp->output) );
-    free( (void*)p_tmp );
+
+// Generate the next output directly into the caller's buffer; no pool, no copies.
+long long int Generator__get_next_into( fuzz_gen_ctx_t* p_ctx, void* p_buf, size_t buf_len ) {
+    if ( NULL == p_ctx || NULL == p_buf || buf_len < 1 )  return -1;
+
+    return __Generator__generate( p_ctx,
+        (unsigned char*)p_buf, ((unsigned char*)p_buf + buf_len), NULL, NULL );
 }
 
 
@@ -539,3 +1148,60 @@ void Generator__get_next_to_stream( fuzz_gen_ctx_t* p_ctx, FILE* fp_to ) {
 fuzz_factory_t* Generator__get_context_factory( fuzz_gen_ctx_t* p_ctx ) {
     return p_ctx->p_factory;
 }
+
+
+// Return the seed this context's PRNG stream was last expanded from.
+uint64_t Generator__get_seed( fuzz_gen_ctx_t* p_ctx ) {
+    return ( NULL != p_ctx ) ? p_ctx->seed : 0;
+}
+
+
+// Deterministically regenerate one output named by a (seed, iteration) coordinate.
+fuzz_str_t* Generator__replay( fuzz_gen_ctx_t* p_ctx, uint64_t seed, uint64_t iteration ) {
+    if ( NULL == p_ctx )  return NULL;
+
+    // A private clone keeps the caller's context (and its live PRNG stream)
+    //   completely untouched by the fast-forward below.
+    fuzz_gen_ctx_t* p_tmp = Generator__clone_context( p_ctx );
+    if ( NULL == p_tmp )  return NULL;
+
+    Generator__seed_context( p_tmp, seed );
+
+    // Burn through the preceding outputs without copying any of them out; peeks
+    //   run the full interpreter (consuming exactly the same PRNG draws as the
+    //   original run did) but lend the pool rather than allocating.
+    for ( uint64_t i = 0; i < iteration; i++ ) {
+        if ( NULL == Generator__peek_next( p_tmp ) ) {
+            Generator__delete_context( p_tmp );
+            return NULL;
+        }
+    }
+
+    fuzz_str_t* p_out = Generator__get_next( p_tmp );
+
+    Generator__delete_context( p_tmp );
+    return p_out;
+}
+
+
+// Fold a context's counters -- and those of its subcontext children -- into 'p_dest'.
+static void __Generator__merge_stats( fuzz_gen_ctx_t* p_ctx, fuzz_stats_block_t* p_dest ) {
+    Stats__merge( p_dest, &(p_ctx->stats) );
+
+    for ( size_t i = 0; i < p_ctx->p_factory->subcontexts_count; i++ ) {
+        // Interned slots alias a canonical child; merge each shared child once.
+        if ( i != (p_ctx->p_factory->subcontexts[i]).intern_of )
+            continue;
+
+        if ( NULL != (p_ctx->sub_states[i]).p_gen_ctx )
+            __Generator__merge_stats( (p_ctx->sub_states[i]).p_gen_ctx, p_dest );
+    }
+}
+
+// Merge the context's statistics tree into the given block (reset first).
+void Generator__get_stats( fuzz_gen_ctx_t* p_ctx, fuzz_stats_block_t* p_dest ) {
+    if ( NULL == p_ctx || NULL == p_dest )  return;
+
+    Stats__reset( p_dest );
+    __Generator__merge_stats( p_ctx, p_dest );
+}
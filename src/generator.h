@@ -11,8 +11,9 @@
 #define NANOFUZZ_GENERATOR_H
 
 #include "pattern.h"
-#include "tinymt64.h"
+#include "stats.h"
 
+#include <stdint.h>
 #include <stdio.h>
 
 
@@ -30,12 +31,11 @@ typedef struct _fuzz_generator_state_vector_t {
     fuzz_gen_ctx_counter_t counter[FUZZ_MAX_NESTING_COMPLEXITY];   // counters for tracking sub-related repetitions
 } fuzz_gen_ctx_state_t;
 
-typedef struct _fuzz_generator_context_t {
-    fuzz_gen_ctx_state_t state;                   // see above; context state
-    fuzz_factory_t* p_factory;       // core of the context: constructed factory
-    unsigned char* p_data_pool;      // stores generated data
-    unsigned char* p_pool_end;       // marks the end of the data pool in memory
-} fuzz_gen_ctx_t;
+// Sink callback for streamed generation: receives successive in-order spans of
+//   one output as the interpreter's window fills. Spans are only valid for the
+//   duration of the call. Return non-zero to keep going; returning 0 aborts the
+//   generation, which then reports a fault.
+typedef int (*fuzz_sink_fn)( const void* p_data, size_t length, void* p_arg );
 
 // Define the structure of generated data. This is simply a void-ptr to a blob, with a strict length.
 typedef struct _fuzz_str_t {
@@ -43,23 +43,123 @@ typedef struct _fuzz_str_t {
     unsigned long long int length;
 } fuzz_str_t;
 
+// Per-context MUTABLE state for one factory subcontext: a child generator context
+//   over the shared immutable sub-factory, plus this context's private scratch slab
+//   (a fuzz_str_t header followed by its payload). Keeping these out of the factory
+//   lets one compiled factory back any number of concurrent generator contexts.
+typedef struct _fuzz_sub_state_t {
+    struct _fuzz_generator_context_t* p_gen_ctx;   // child ctx; owned by this context
+    fuzz_str_t* p_most_recent;   // lifetime slab holding the latest shuffled output
+} fuzz_sub_state_t;
+
+typedef struct _fuzz_generator_context_t {
+    fuzz_gen_ctx_state_t state;                   // see above; context state
+    fuzz_factory_t* p_factory;       // core of the context: constructed factory (shared, read-only)
+    int owns_factory;                // non-zero when deleting this ctx also deletes the factory
+    unsigned char* p_data_pool;      // stores generated data (lazy anonymous mapping)
+    unsigned char* p_pool_end;       // marks the end of the data pool in memory
+    size_t pool_size;                // mapped pool length, page-rounded
+    size_t pool_resident;            // high-water of pool bytes touched since the last trim
+    size_t pool_prefix_resident;     // baked constant-prefix bytes still valid at the pool front
+    fuzz_str_t view;                 // borrow-style view of the latest peeked output
+    uint64_t prng[2];                // per-context Xoshiro128+ state; never shared
+    uint64_t seed;                   // seed the PRNG was last expanded from (replay coordinate)
+    fuzz_stats_block_t stats;        // plain per-context counters; merged on read
+    // Mutable subcontext state, index-aligned with the factory's subcontexts table.
+    fuzz_sub_state_t sub_states[FUZZ_MAX_SUBCONTEXTS];
+} fuzz_gen_ctx_t;
+
+// A single item inside a generated batch. The actual bytes live in the batch's
+//   shared arena, so each record is just an (offset,length) pair into it.
+typedef struct _fuzz_str_rec_t {
+    size_t offset;   // offset of this item's first byte within the batch arena
+    unsigned long long int length;   // generated length of this item
+} fuzz_str_rec_t;
+
+// A batch of generated outputs. The header, the records array, and the arena all
+//   live inside ONE contiguous lazy anonymous mapping, so a batch costs a single
+//   mmap and a single munmap regardless of how many items it holds -- and only
+//   the pages generation actually touches ever become resident.
+typedef struct _fuzz_batch_t {
+    fuzz_str_rec_t* p_records;   // one record per generated item
+    size_t count;   // amount of records actually generated
+    unsigned char* p_arena;   // contiguous blob holding every item's bytes
+    size_t arena_size;   // total capacity of the arena in bytes
+    size_t map_size;   // full length of the backing mapping (header included)
+} fuzz_batch_t;
+
 
 
 // Create a new generator context with a factory to 'prime' generation a bit.
+//   The context takes ownership of the factory; deleting it deletes the factory too.
 fuzz_gen_ctx_t* Generator__new_context( fuzz_factory_t* p_factory );
+// Same, but seed the context's PRNG deterministically for reproducible streams.
+fuzz_gen_ctx_t* Generator__new_context_seeded( fuzz_factory_t* p_factory, uint64_t seed );
+// Clone a context over the SAME immutable factory: fresh PRNG stream, data pool,
+//   and subcontext scratch, with zero reparsing. The clone does NOT own the factory,
+//   so it must be deleted before (or independently of) the owning context.
+fuzz_gen_ctx_t* Generator__clone_context( fuzz_gen_ctx_t* p_ctx );
+// Re-seed a context's PRNG state (splitmix64-expanded), including well-separated
+//   derived streams for every subcontext's child generator.
+void Generator__seed_context( fuzz_gen_ctx_t* p_ctx, uint64_t seed );
 // Deletes an allocated generator context and its PRNG.
 void Generator__delete_context( fuzz_gen_ctx_t* p_ctx );
 
 // Generate more data using the given factory.
 //   NOTE: The return value resides on the heap and must be freed by the caller.
 fuzz_str_t* Generator__get_next( fuzz_gen_ctx_t* p_ctx );
+// Generate 'n' outputs back-to-back into a single contiguous arena. Returns NULL when
+//   any of the runs fails to generate. The batch is one allocation; free it with the
+//   delete call below (do NOT free the records or arena individually).
+fuzz_batch_t* Generator__get_next_n( fuzz_gen_ctx_t* p_ctx, size_t n );
+// Free a batch and every record/output inside it.
+void Generator__delete_batch( fuzz_batch_t* p_batch );
+// Generate the next output but LEND the context's own data pool rather than copying
+//   it out: no calloc, no memcpy, no pool-clearing memset. The returned view is only
+//   valid until the next generation call on the same context. Do NOT free it.
+const fuzz_str_t* Generator__peek_next( fuzz_gen_ctx_t* p_ctx );
 // Instead of returning heap data, manages the memory for the caller and
 //   writes the generated content directly to the given I/O stream.
 void Generator__get_next_to_stream( fuzz_gen_ctx_t* p_ctx, FILE* fp_to );
+// Generate the next output DIRECTLY into the caller's buffer (e.g. a shared-memory
+//   ring slot), bypassing the context's data pool and every intermediate copy.
+//   Returns the generated length, or -1 when generation faults or the output
+//   cannot fit in 'buf_len' bytes.
+long long int Generator__get_next_into( fuzz_gen_ctx_t* p_ctx, void* p_buf, size_t buf_len );
+// Stream the next output through the caller's sink in bounded chunks instead of
+//   materializing it: the interpreter writes into a fixed-size front window of the
+//   data pool and hands each filled window to 'p_sink' in order, so memory stays
+//   constant no matter how large the output grows. Repeated units larger than the
+//   window are themselves emitted in pieces; only variable subcontext payloads
+//   still materialize fully (in their own scratch slabs, bounded by the SUB-
+//   factory's worst case, since references and length fields read them back).
+//   Returns the total streamed length, or -1 when generation faults or the sink
+//   rejects a span.
+long long int Generator__get_next_to_sink( fuzz_gen_ctx_t* p_ctx, fuzz_sink_fn p_sink, void* p_arg );
 
 // Return the factory used by a gen ctx.
 fuzz_factory_t* Generator__get_context_factory( fuzz_gen_ctx_t* p_ctx );
 
+// Return the seed this context's PRNG was last expanded from. Together with the
+//   count of outputs generated so far (see the stats block), this forms the
+//   16-byte (seed, iteration) coordinate which deterministically names every
+//   output the context will ever produce -- record THAT instead of the bytes.
+uint64_t Generator__get_seed( fuzz_gen_ctx_t* p_ctx );
+
+// Deterministically re-derive output #'iteration' (0-based) of the run seeded
+//   with 'seed', over the same compiled factory as 'p_ctx'. A throwaway clone is
+//   re-seeded and fast-forwarded through the preceding iterations (each output
+//   consumes a data-dependent number of PRNG draws, so the stream cannot simply
+//   be jumped past them), then the target output is returned on the heap exactly
+//   as Generator__get_next would have produced it. The given context's own state
+//   is never touched. Returns NULL on any generation fault along the way.
+fuzz_str_t* Generator__replay( fuzz_gen_ctx_t* p_ctx, uint64_t seed, uint64_t iteration );
+
+// Merge the context's statistics (and those of every subcontext child generator,
+//   recursively) into 'p_dest', which is reset first. Counters are maintained
+//   without atomics, so reads concurrent with generation are approximate.
+void Generator__get_stats( fuzz_gen_ctx_t* p_ctx, fuzz_stats_block_t* p_dest );
+
 
 
 #endif   /* NANOFUZZ_GENERATOR_H */
@@ -5,6 +5,8 @@
  *
  */
 
+#define _GNU_SOURCE   /* sched_getaffinity / pthread_setaffinity_np */
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -17,13 +19,38 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 
+#include <fcntl.h>
 #include <linux/limits.h>
 
 #include "api.h"
 
 // Define constants as necessary.
 #define FUZZ_MAX_THREADS 16
+// How many jobs a worker thread claims from the shared counter at a time.
+//   Chunked claims amortize contention on the counter while staying small
+//   enough that no core idles at the tail of wildly variable-cost patterns.
+#define FUZZ_JOB_CHUNK 256
+// Depth of the submission queue between generator threads and the output writer.
+#define FUZZ_WRITER_QUEUE_DEPTH 512
+// How many queued items the writer drains per window. Opens, writes, and closes
+//   are issued in clustered passes over the window to keep syscalls batched.
+#define FUZZ_WRITER_BATCH 64
+
+// Packed corpus ('-P') layout: a 16-byte header (magic, version), then back-to-back
+//   records of a 32-bit length prefix plus payload, then a trailing index of every
+//   record's absolute offset followed by a fixed 24-byte trailer (index offset,
+//   record count, magic) so readers find the index by seeking to the end. A file
+//   cut short by a crash simply lacks the index; extraction falls back to walking
+//   the length prefixes, losing nothing that reached the disk.
+#define FUZZ_CORPUS_MAGIC 0x535550524F434E46ULL   /* "FNCORPUS" */
+#define FUZZ_CORPUS_VERSION 1
+// Records per durability checkpoint (flush + fsync) while appending.
+#define FUZZ_CORPUS_CHECKPOINT 8192
+// stdio buffer behind corpus appends; multi-MB sequential writes, few syscalls.
+#define FUZZ_CORPUS_WRITE_BUFFER (1 << 22)
 
 
 
@@ -42,6 +69,11 @@ static void __print_usage_info() {
         "    -f, --file         Read the pattern schema from a specified text file.\n"
         "    -t, --threads      Number of threads to spawn (between 1 and %d) for generation.\n"
         "                         Be careful setting this option above available resources.\n"
+        "    -a, --affinity     Pin generation threads round-robin across the CPUs the process\n"
+        "                         is allowed to run on. Generator memory is placed by first\n"
+        "                         touch, so pinned threads keep their data pools and output\n"
+        "                         batches on their own NUMA node instead of paying cross-node\n"
+        "                         write traffic on multi-socket machines.\n"
         "    -l, --limit        Print only 'count' generated lines and stop.\n"
         "    -w, --whitespace   Interpret all input white-space characters (' ', TAB, LF, etc.)\n"
         "                         as part of the pattern sequence. When this option is NOT used,\n"
@@ -57,6 +89,34 @@ static void __print_usage_info() {
         "                         is used) or a filename pattern with a wildcard '*' in it. This\n"
         "                         wildcard expands to the current iteration number, from 0 to\n"
         "                         the '--limit' value minus one, if specified.\n"
+        "    -c, --compile      Parse the pattern, write its compiled form to the given file,\n"
+        "                         and exit. Use together with '-i', '-p', or '-f'. The file can\n"
+        "                         then be loaded with '--compiled' to skip parsing entirely.\n"
+        "    -C, --compiled     Load a pattern previously compiled with '--compile' instead of\n"
+        "                         parsing a schema. Mutually exclusive with '-i', '-p', and '-f'.\n"
+        "    -s, --stats        After generation completes, print statistics about the run:\n"
+        "                         outputs and bytes generated, per-block-type execution counts,\n"
+        "                         the largest single output, and any generation faults. With\n"
+        "                         '-t', counters from every worker thread are merged.\n"
+        "    -S, --seed         Seed the generator deterministically with the given decimal\n"
+        "                         64-bit value: two runs over the same pattern and seed emit\n"
+        "                         the same outputs in the same order, so any single case is\n"
+        "                         fully named by its seed and iteration number alone. Cannot\n"
+        "                         be combined with '-t' or '-C'.\n"
+        "    -r, --replay       Regenerate exactly ONE output from a 'seed:iteration'\n"
+        "                         coordinate (as produced by a '--seed' run, 0-based) and\n"
+        "                         print it, or write it to the '-o' file if given. Replaces\n"
+        "                         archiving whole corpora just to reproduce a crashing case.\n"
+        "    -P, --pack         Append every generated output to ONE packed corpus file of\n"
+        "                         length-prefixed records (with a trailing offset index and\n"
+        "                         periodic fsync checkpoints) instead of one file each via\n"
+        "                         '-o'. Large sequential writes replace millions of file\n"
+        "                         creations. Cannot be combined with '-e' or '-o'.\n"
+        "    -x, --corpus-extract\n"
+        "                         Pull cases back out of a packed corpus. The argument is\n"
+        "                         'file:N' for the single record #N (0-based, to STDOUT or\n"
+        "                         the '-o' file), or 'file:*' to unpack every record through\n"
+        "                         a wildcard '-o' template. No pattern input is needed.\n"
         "\n"
         "\n", FUZZ_MAX_THREADS
     );
@@ -67,11 +127,10 @@ static void __print_usage_info() {
 
 // Other function declarations.
 void* thread_do_work( void* p_work );
-void thread_update_amount( size_t generated );
 static void register_signal_handlers();
 static void handle_signal( int signal );
 static char* read_data_from_file( FILE* fp_file, bool gets_size );
-void write_to_out_file( nanofuzz_data_t* p_data, size_t gen_num, size_t pfx );
+static void __format_out_filename( char* p_filename, size_t gen_num, size_t pfx );
 
 #ifdef FUNCTION_PROFILING
 #define printf //##NAME
@@ -87,11 +146,12 @@ void __profiling_print_stats( void )
 
 
 // Internal structure for providing spawned threads with information and 'work to do'.
+//   Workers pull their job numbers from the shared '_next_job' counter in chunks,
+//   so the only per-thread state is the context and a locally-owned progress count.
 typedef struct _thread_work_t {
     nanofuzz_context_t* p_fuzz_ctx;   //reuseable generator context (pattern never changes)
-    size_t jobs;   //amount to generate
-    size_t counter;   //number to start at (when outputting to files)
-    size_t pfx;   //file prefix in case of overflows in 'counter'
+    size_t pfx;   //file prefix in case of overflows in the job number
+    _Atomic size_t done;   //items completed; written relaxed here, aggregated by main
 } thread_work_t;
 
 // Thread context wrapper struct.
@@ -100,14 +160,84 @@ typedef struct _thread_ctx_t {
     thread_work_t* p_work;   //its workload
 } thread_ctx_t;
 
+// A single queued unit of file output awaiting the writer thread.
+typedef struct _write_job_t {
+    nanofuzz_context_t* p_fuzz_ctx;   //context which produced (and later recycles) the data
+    nanofuzz_data_t* p_data;   //the generated item to persist
+    size_t gen_num;   //iteration number used in wildcard expansion
+    size_t pfx;   //file prefix in case of overflows in 'gen_num'
+} write_job_t;
+
+// Batched asynchronous output writer. Generator threads never touch the disk
+//   directly: they enqueue finished items into a bounded submission queue and a
+//   dedicated writer thread drains it in windows, overlapping file I/O with
+//   content generation. Submitters only ever stall when the disk falls a full
+//   queue-depth behind the generators.
+static write_job_t _writer_queue[FUZZ_WRITER_QUEUE_DEPTH];
+static size_t _writer_head = 0;   //next slot to dequeue
+static size_t _writer_tail = 0;   //next slot to enqueue
+static size_t _writer_pending = 0;   //amount of jobs currently queued
+static bool _writer_shutdown = false;   //set once generation is complete
+static pthread_mutex_t _writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _writer_nonempty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _writer_nonfull = PTHREAD_COND_INITIALIZER;
+static pthread_t _writer_thread;
+
+static void __writer_start();
+static void __writer_finish();
+static void __writer_submit(
+    nanofuzz_context_t* p_ctx, nanofuzz_data_t* p_data, size_t gen_num, size_t pfx );
+static void* __writer_thread_main( void* p_arg );
+static void __writer_flush_batch( write_job_t* p_jobs, size_t amount );
+
+// Packed corpus state; only ever touched by the main thread (open/close) and the
+//   single writer thread (appends), so no locking beyond the writer queue's own.
+static FILE* _corpus_fp = NULL;
+static uint64_t* _corpus_offsets = NULL;   //absolute offset of every record written
+static size_t _corpus_count = 0;
+static size_t _corpus_capacity = 0;
+static uint64_t _corpus_cursor = 0;   //current append position in the file
+
+static void __corpus_open();
+static void __corpus_append( const nanofuzz_data_t* p_data );
+static void __corpus_close();
+static void __corpus_extract( const char* p_path, uint64_t index, bool all );
+
+
+// '--affinity' support. Pools and batch arenas are lazy mappings whose pages are
+//   placed wherever the writing thread first touches them, so all the NUMA work
+//   the CLI needs to do is stop threads from migrating: pin workers round-robin
+//   over the allowed CPU set and first-touch does the node-local placement.
+static size_t __affinity_cpu_list( int* p_cpus, size_t max ) {
+    cpu_set_t set;
+    size_t amount = 0;
+
+    if (  sched_getaffinity( 0, sizeof(cpu_set_t), &set )  )
+        return 0;
+
+    for ( int c = 0; c < CPU_SETSIZE && amount < max; c++ )
+        if (  CPU_ISSET( c, &set )  )
+            *(p_cpus+(amount++)) = c;
+
+    return amount;
+}
+
+// Best-effort pin of the calling thread; pinning is an optimization, never fatal.
+static void __affinity_pin_self( int cpu ) {
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu, &set );
+
+    pthread_setaffinity_np( pthread_self(), sizeof(cpu_set_t), &set );
+}
+
 
 // Define global variables as needed.
-static size_t amount_generated = 0;   // Amount done so far
 static size_t amount_to_generate = 1;   // Amount of cycles
-static pthread_mutex_t _amount_mutex   // mutex for ^ counter
-    = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic size_t _next_job = 0;   // Shared work counter; claimed in chunks
 static thread_ctx_t* threads[FUZZ_MAX_THREADS];   // App-global thread context ptrs
 static char* p_output_file = NULL;   //pointer to the template name of out files
+static char* p_corpus_file = NULL;   //path of the packed corpus file, when '-P' is used
 
 
 // Define a flags register and some bit indices.
@@ -121,6 +251,14 @@ static uint32_t app_flags = 0x00000000;
 #define FLAG_OUTFILE_DYNAMIC (1 << 6)
 #define FLAG_THREAD_COUNT (1 << 7)
 #define FLAG_ECHO_OUTPUT (1 << 8)
+#define FLAG_COMPILE_OUT (1 << 9)
+#define FLAG_PATTERN_COMPILED (1 << 10)
+#define FLAG_PRINT_STATS (1 << 11)
+#define FLAG_SEED_SET (1 << 12)
+#define FLAG_REPLAY (1 << 13)
+#define FLAG_PACK_CORPUS (1 << 14)
+#define FLAG_CORPUS_EXTRACT (1 << 15)
+#define FLAG_AFFINITY (1 << 16)
 
 
 
@@ -137,10 +275,18 @@ int main( int argc, char* const argv[] ) {
         { "pattern",    required_argument,  NULL,  'p' },
         { "file",       required_argument,  NULL,  'f' },
         { "threads",    required_argument,  NULL,  't' },
+        { "affinity",   no_argument,        NULL,  'a' },
         { "limit",      required_argument,  NULL,  'l' },
         { "whitespace", no_argument,        NULL,  'w' },
         { "echo",       no_argument,        NULL,  'e' },
         { "output",     required_argument,  NULL,  'o' },
+        { "compile",    required_argument,  NULL,  'c' },
+        { "compiled",   required_argument,  NULL,  'C' },
+        { "stats",      no_argument,        NULL,  's' },
+        { "seed",       required_argument,  NULL,  'S' },
+        { "replay",     required_argument,  NULL,  'r' },
+        { "pack",       required_argument,  NULL,  'P' },
+        { "corpus-extract", required_argument, NULL, 'x' },
         { NULL,         0,                  NULL,   0  }
     };
 
@@ -151,9 +297,19 @@ int main( int argc, char* const argv[] ) {
 
     char* p_pattern_file_path = NULL;
     char* p_pattern_contents = NULL;
+    char* p_compile_out_path = NULL;
+    char* p_compiled_in_path = NULL;
+
+    uint64_t run_seed = 0;
+    uint64_t replay_seed = 0;
+    uint64_t replay_iteration = 0;
+
+    char* p_corpus_extract_file = NULL;
+    uint64_t extract_index = 0;
+    bool extract_all = false;
 
     for ( ; ; ) {
-        cli_opt = getopt_long( argc, argv, "hip:f:t:l:weo:", cli_long_opts, &cli_opt_idx );
+        cli_opt = getopt_long( argc, argv, "hisap:f:t:l:weo:c:C:S:r:P:x:", cli_long_opts, &cli_opt_idx );
         if ( cli_opt == -1 )  break;
         switch ( cli_opt ) {
             case '?':
@@ -209,9 +365,6 @@ int main( int argc, char* const argv[] ) {
                 break;
 
             case 't':
-#ifdef FUNCTION_PROFILING
-                errx( 1, "Threaded operation is NOT SUPPORTED when running the 'profile' build.\n\n" );
-#endif   /* FUNCTION_PROFILING */
                 if ( (app_flags & FLAG_THREAD_COUNT) )
                     errx( 1, "The count of worker threads can only be specified once.\n" );
                 else if ( (app_flags & FLAG_ECHO_OUTPUT) )
@@ -261,6 +414,13 @@ int main( int argc, char* const argv[] ) {
 
                 break;
 
+            case 'a':
+                if ( (app_flags & FLAG_AFFINITY) )
+                    errx( 1, "The affinity '-a' option can only be specified once.\n" );
+
+                app_flags |= FLAG_AFFINITY;
+                break;
+
             case 'w':
                 if ( (app_flags & FLAG_NO_SCRUB_WHITESPACE) )
                     errx( 1, "The preserve whitespace '-w' option can only be specified once.\n" );
@@ -275,6 +435,8 @@ int main( int argc, char* const argv[] ) {
                     errx( 1, "The echo option '-e' cannot be used with the write-to-file '-o' option.\n" );
                 else if ( (app_flags & FLAG_THREAD_COUNT) )
                     errx( 1, "The echo option '-e' cannot be used with the threads '-t' option.\n" );
+                else if ( (app_flags & FLAG_PACK_CORPUS) )
+                    errx( 1, "The echo option '-e' cannot be used with the packed corpus '-P' option.\n" );
 
                 app_flags |= FLAG_ECHO_OUTPUT;
                 break;
@@ -284,6 +446,8 @@ int main( int argc, char* const argv[] ) {
                     errx( 1, "The output file format '-o' can only be specified once.\n" );
                 else if ( (app_flags & FLAG_ECHO_OUTPUT) )
                     errx( 1, "The output file format '-o' cannot be used with the echo '-e' option.\n" );
+                else if ( (app_flags & FLAG_PACK_CORPUS) )
+                    errx( 1, "The output file format '-o' cannot be used with the packed corpus '-P' option.\n" );
 
                 // -32 to account for size_t string expansion
                 p_output_file = strndup( optarg, (PATH_MAX-33) );
@@ -302,16 +466,181 @@ int main( int argc, char* const argv[] ) {
                 }
 
                 break;
+
+            case 'c':
+                if ( (app_flags & FLAG_COMPILE_OUT) )
+                    errx( 1, "The compile output file '-c' can only be specified once.\n" );
+
+                p_compile_out_path = strndup( optarg, (PATH_MAX-1) );
+                if ( NULL == p_compile_out_path || strnlen( p_compile_out_path, 1 ) < 1 )
+                    errx( 1, "Misunderstood output filename for the '-c' option.\n" );
+
+                app_flags |= FLAG_COMPILE_OUT;
+                break;
+
+            case 'C':
+                if ( (app_flags & FLAG_PATTERN_COMPILED) )
+                    errx( 1, "The compiled pattern file '-C' can only be specified once.\n" );
+
+                p_compiled_in_path = strndup( optarg, (PATH_MAX-1) );
+                if ( NULL == p_compiled_in_path || strnlen( p_compiled_in_path, 1 ) < 1 )
+                    errx( 1, "Misunderstood input filename for the '-C' option.\n" );
+
+                app_flags |= FLAG_PATTERN_COMPILED;
+                break;
+
+            case 's':
+                if ( (app_flags & FLAG_PRINT_STATS) )
+                    errx( 1, "The stats option is already set.\n" );
+
+                app_flags |= FLAG_PRINT_STATS;
+                break;
+
+            case 'S':
+                if ( (app_flags & FLAG_SEED_SET) )
+                    errx( 1, "The generator seed can only be specified once.\n" );
+
+                for ( const char* x = optarg; (*x); x++ )
+                    if ( !isdigit( (int)(*x) ) )
+                        errx( 1, "The '-S' option's value must be a positive, base-10 (decimal) integer.\n" );
+
+                errno = 0;
+                run_seed = (uint64_t)strtoull( optarg, NULL, 10 );
+                if ( errno ) {
+                    perror( "'-S' option" );
+                    exit( 1 );
+                }
+
+                app_flags |= FLAG_SEED_SET;
+                break;
+
+            case 'P':
+                if ( (app_flags & FLAG_PACK_CORPUS) )
+                    errx( 1, "The packed corpus file '-P' can only be specified once.\n" );
+                else if ( (app_flags & FLAG_ECHO_OUTPUT) )
+                    errx( 1, "The packed corpus '-P' option cannot be used with the echo '-e' option.\n" );
+                else if ( (app_flags & FLAG_WRITE_TO_FILE) )
+                    errx( 1, "The packed corpus '-P' option cannot be used with the write-to-file '-o' option.\n" );
+
+                p_corpus_file = strndup( optarg, (PATH_MAX-1) );
+                if ( NULL == p_corpus_file || strnlen( p_corpus_file, 1 ) < 1 )
+                    errx( 1, "Misunderstood corpus filename for the '-P' option.\n" );
+
+                app_flags |= FLAG_PACK_CORPUS;
+                break;
+
+            case 'x': {
+                if ( (app_flags & FLAG_CORPUS_EXTRACT) )
+                    errx( 1, "The corpus extraction '-x' option can only be specified once.\n" );
+
+                // The argument format is 'file:N' (0-based index) or 'file:*' for all records.
+                const char* p_colon = strrchr( optarg, ':' );
+                if ( NULL == p_colon || p_colon == optarg || !strnlen( (p_colon+1), 1 ) )
+                    errx( 1, "The '-x' option's value must be a 'file:N' or 'file:*' specifier.\n" );
+
+                if (  0 == strcmp( (p_colon+1), "*" )  ) {
+                    extract_all = true;
+                } else {
+                    for ( const char* y = (p_colon+1); (*y); y++ )
+                        if ( !isdigit( (int)(*y) ) )
+                            errx( 1, "The '-x' record index must be a positive, base-10"
+                                " (decimal) integer or '*'.\n" );
+
+                    errno = 0;
+                    extract_index = (uint64_t)strtoull( (p_colon+1), NULL, 10 );
+                    if ( errno ) {
+                        perror( "'-x' option" );
+                        exit( 1 );
+                    }
+                }
+
+                p_corpus_extract_file = strndup( optarg, (p_colon - optarg) );
+                if ( NULL == p_corpus_extract_file || strnlen( p_corpus_extract_file, 1 ) < 1 )
+                    errx( 1, "Misunderstood corpus filename for the '-x' option.\n" );
+
+                app_flags |= FLAG_CORPUS_EXTRACT;
+                break;
+            }
+
+            case 'r': {
+                if ( (app_flags & FLAG_REPLAY) )
+                    errx( 1, "The replay coordinate can only be specified once.\n" );
+
+                // The coordinate format is 'seed:iteration', both decimal 64-bit values.
+                const char* p_colon = strchr( optarg, ':' );
+                if ( NULL == p_colon || p_colon == optarg || !strnlen( (p_colon+1), 1 ) )
+                    errx( 1, "The '-r' option's value must be a 'seed:iteration' coordinate.\n" );
+
+                for ( const char* x = optarg; (*x); x++ )
+                    if ( !isdigit( (int)(*x) ) && x != p_colon )
+                        errx( 1, "The '-r' coordinate's seed and iteration must both be"
+                            " positive, base-10 (decimal) integers.\n" );
+
+                errno = 0;
+                replay_seed = (uint64_t)strtoull( optarg, NULL, 10 );
+                replay_iteration = (uint64_t)strtoull( (p_colon+1), NULL, 10 );
+                if ( errno ) {
+                    perror( "'-r' option" );
+                    exit( 1 );
+                }
+
+                app_flags |= FLAG_REPLAY;
+                break;
+            }
         }
     }
 
 
+    // The compiled-pattern input is its own pattern source and cannot mix with the others.
+    if ( (app_flags & FLAG_PATTERN_COMPILED) ) {
+        if ( (app_flags & (FLAG_PATTERN_STDIN | FLAG_PATTERN_STRING | FLAG_PATTERN_FILE)) )
+            errx( 1, "The compiled pattern '-C' option cannot be combined with '-i', '-p', or '-f'.\n" );
+        if ( (app_flags & FLAG_COMPILE_OUT) )
+            errx( 1, "The '-c' option requires a schema source; it cannot re-compile a compiled file.\n" );
+    } else if ( (app_flags & FLAG_COMPILE_OUT) ) {
+        if ( !(app_flags & (FLAG_PATTERN_STDIN | FLAG_PATTERN_STRING | FLAG_PATTERN_FILE)) )
+            errx( 1, "The compile '-c' option requires a pattern from '-i', '-p', or '-f'.\n" );
+    }
+
+
     // Make sure that if threading is enabled, a wildcard was used in the output filename.
     if ( (app_flags & FLAG_WRITE_TO_FILE) && (app_flags & FLAG_THREAD_COUNT) )
         if ( !(app_flags & FLAG_OUTFILE_DYNAMIC) )
             errx( 1, "Threading with file output REQUIRES the use of a"
                 " wildcard '*' character in the outfile.\n" );
 
+    // Deterministic runs need the one seeded stream: worker-thread clones draw their
+    //   own random streams, and from-factory contexts cannot currently be re-seeded.
+    if ( (app_flags & FLAG_SEED_SET) ) {
+        if ( (app_flags & FLAG_THREAD_COUNT) )
+            errx( 1, "The seed '-S' option cannot be used with the threads '-t' option.\n" );
+        if ( (app_flags & FLAG_PATTERN_COMPILED) )
+            errx( 1, "The seed '-S' option cannot be used with the compiled pattern '-C' option.\n" );
+    }
+
+    // Replay carries its own coordinate and produces exactly one output.
+    if ( (app_flags & FLAG_REPLAY) ) {
+        if ( (app_flags & FLAG_THREAD_COUNT) )
+            errx( 1, "The replay '-r' option cannot be used with the threads '-t' option.\n" );
+        if ( (app_flags & FLAG_SEED_SET) )
+            errx( 1, "The replay '-r' option already carries a seed; it cannot be used with '-S'.\n" );
+    }
+
+    // Corpus extraction is a standalone mode working purely off the packed file.
+    if ( (app_flags & FLAG_CORPUS_EXTRACT) ) {
+        if ( (app_flags & (FLAG_PACK_CORPUS | FLAG_THREAD_COUNT | FLAG_REPLAY)) )
+            errx( 1, "The corpus extraction '-x' option cannot be combined with '-P', '-t', or '-r'.\n" );
+        if ( extract_all && !(app_flags & FLAG_OUTFILE_DYNAMIC) )
+            errx( 1, "Extracting every record ('file:*') REQUIRES a wildcard '*'"
+                " character in the '-o' outfile template.\n" );
+
+        __corpus_extract( p_corpus_extract_file, extract_index, extract_all );
+
+        free( p_corpus_extract_file );
+        free( p_output_file );
+        return 0;
+    }
+
 
     // Now double-check options provided through the application's options as needed.
     if ( (app_flags & FLAG_PATTERN_FILE) ) {
@@ -370,18 +699,60 @@ int main( int argc, char* const argv[] ) {
     }
 
 
-    // Check that a pattern actually exists to parse.
-    if ( NULL == p_pattern_contents || !strnlen( p_pattern_contents, 1 ) )
+    // Check that a pattern actually exists to parse (compiled files carry their own).
+    if (  !(app_flags & FLAG_PATTERN_COMPILED)
+        && (NULL == p_pattern_contents || !strnlen( p_pattern_contents, 1 ))  )
         errx( 1, "A pattern to parse was not found. Please check the provided options and try again.\n" );
 
     // Create a new error context to read problems from the pattern string, if any.
     fuzz_error_t* p_err_ctx = NULL;
 
-    // Parse the input pattern and init a fuzzer context.
-    nanofuzz_context_t* p_fuzz_ctx = ( amount_to_generate )
-        ? Nanofuzz__new( p_pattern_contents, amount_to_generate, oneshot, &p_err_ctx )
-        : Nanofuzz__new( p_pattern_contents, 10000, refill, &p_err_ctx )
-    ;
+    // Compile-only mode: parse the schema, serialize the factory, and exit.
+    if ( (app_flags & FLAG_COMPILE_OUT) ) {
+        fuzz_factory_t* p_factory = PatternFactory__new( p_pattern_contents, &p_err_ctx );
+        if ( NULL == p_factory ) {
+            Error__print( p_err_ctx, stderr );
+            exit( 1 );
+        }
+
+        if (  !PatternFactory__save( p_factory, p_compile_out_path )  )
+            errx( 1, "Unable to write the compiled pattern to '%s'.\n", p_compile_out_path );
+
+        printf( "Compiled pattern written to '%s'.\n", p_compile_out_path );
+
+        PatternFactory__delete( p_factory );
+        free( p_compile_out_path );
+        free( p_pattern_contents );
+        return 0;
+    }
+
+    // Init a fuzzer context, either from a compiled factory file (an mmap and a
+    //   fixup pass -- no parsing) or by parsing the input pattern.
+    nanofuzz_context_t* p_fuzz_ctx = NULL;
+
+    if ( (app_flags & FLAG_PATTERN_COMPILED) ) {
+        fuzz_factory_t* p_factory = PatternFactory__load_mmap( p_compiled_in_path, &p_err_ctx );
+
+        if ( NULL != p_factory ) {
+            p_fuzz_ctx = ( amount_to_generate )
+                ? Nanofuzz__new_from_factory( p_factory, amount_to_generate, oneshot )
+                : Nanofuzz__new_from_factory( p_factory, 10000, refill )
+            ;
+        }
+
+        free( p_compiled_in_path );
+        p_compiled_in_path = NULL;
+    } else if ( (app_flags & FLAG_SEED_SET) ) {
+        p_fuzz_ctx = ( amount_to_generate )
+            ? Nanofuzz__new_seeded( p_pattern_contents, amount_to_generate, oneshot, run_seed, &p_err_ctx )
+            : Nanofuzz__new_seeded( p_pattern_contents, 10000, refill, run_seed, &p_err_ctx )
+        ;
+    } else {
+        p_fuzz_ctx = ( amount_to_generate )
+            ? Nanofuzz__new( p_pattern_contents, amount_to_generate, oneshot, &p_err_ctx )
+            : Nanofuzz__new( p_pattern_contents, 10000, refill, &p_err_ctx )
+        ;
+    }
 
     if ( NULL == p_fuzz_ctx ) {
         Error__print( p_err_ctx, stderr );
@@ -394,9 +765,44 @@ int main( int argc, char* const argv[] ) {
         Nanofuzz__PatternFactory__explain( stdout, p_fuzz_ctx );
     }
 
+    // Resolve the allowed-CPU list once when '--affinity' is in play. Without
+    //   worker threads the main thread and the context's refill producers all pin
+    //   to the first allowed CPU; threaded runs place each worker round-robin below.
+    int affinity_cpus[CPU_SETSIZE];
+    size_t affinity_cpu_count = 0;
+
+    if ( (app_flags & FLAG_AFFINITY) ) {
+        affinity_cpu_count = __affinity_cpu_list( &(affinity_cpus[0]), CPU_SETSIZE );
+
+        if ( affinity_cpu_count > 0 && worker_threads <= 1 ) {
+            __affinity_pin_self( affinity_cpus[0] );
+            Nanofuzz__pin_producers( p_fuzz_ctx, affinity_cpus[0] );
+        }
+    }
+
+    // When writing generated items to disk, spin up the output writer pipeline
+    //   so the generation loops below never block on file I/O themselves.
+    if ( (app_flags & (FLAG_WRITE_TO_FILE | FLAG_PACK_CORPUS)) )  __writer_start();
+
     // Generate data using the constructed context. If amount_to_generate is less than 1
     //   the program will loop. This is intentional.
-    if ( worker_threads <= 1 ) {
+    if ( (app_flags & FLAG_REPLAY) ) {
+        // Re-derive the single output named by the coordinate instead of looping.
+        nanofuzz_data_t* p_data = Nanofuzz__replay( p_fuzz_ctx, replay_seed, replay_iteration );
+
+        if ( NULL == p_data )
+            errx( 1, "Replay of coordinate %llu:%llu failed to generate.\n",
+                (unsigned long long)replay_seed, (unsigned long long)replay_iteration );
+
+        if ( (app_flags & (FLAG_WRITE_TO_FILE | FLAG_PACK_CORPUS)) ) {
+            // The writer owns the data from here; it recycles it once flushed.
+            __writer_submit( p_fuzz_ctx, p_data, 0, 0 );
+        } else {
+            printf(  "%s\n", (const char*)(p_data->output)  );
+            Nanofuzz__delete_data( p_fuzz_ctx, p_data );
+        }
+
+    } else if ( worker_threads <= 1 ) {
         size_t i = 0, gen_num = 0, pfx = 0;
 
         while ( i < amount_to_generate || !amount_to_generate ) {
@@ -404,19 +810,21 @@ int main( int argc, char* const argv[] ) {
             nanofuzz_data_t* p_data = Nanofuzz__get_next( p_fuzz_ctx );
 
             if ( NULL != p_data ) {
-                if ( (app_flags & FLAG_WRITE_TO_FILE) ) {
-                    write_to_out_file( p_data, gen_num, pfx );
-                } else if ( (app_flags & FLAG_ECHO_OUTPUT) ) {
-                    printf(  "%s\n", (const char*)(p_data->output)  );
+                if ( (app_flags & (FLAG_WRITE_TO_FILE | FLAG_PACK_CORPUS)) ) {
+                    // The writer owns the data from here; it recycles it once flushed.
+                    __writer_submit( p_fuzz_ctx, p_data, gen_num, pfx );
+                } else {
+                    if ( (app_flags & FLAG_ECHO_OUTPUT) )
+                        printf(  "%s\n", (const char*)(p_data->output)  );
+
+                    // Delete the data.
+                    Nanofuzz__delete_data( p_fuzz_ctx, p_data );
                 }
             } else {
                 printf( "Content generation failure.\n" );
                 exit(1);
             }
 
-            // Delete the data.
-            Nanofuzz__delete_data( p_fuzz_ctx, p_data );
-
             // Increment the counter.
             if ( amount_to_generate )  i++;
 
@@ -430,41 +838,46 @@ int main( int argc, char* const argv[] ) {
         memset( &threads, 0, (sizeof(thread_ctx_t*)*FUZZ_MAX_THREADS) );
 
         thread_ctx_t** pp_tctx = &(threads[0]);
-        fuzz_error_t* p_dummy_ctx = NULL;
 
         for ( size_t i = 0; i < worker_threads; i++ ) {
             *(pp_tctx+i) = (thread_ctx_t*)calloc( 1, sizeof(thread_ctx_t) );
 
-            // Assign the work to-do based on the amount to generate and the amount of threads.
+            // No static split of the work here: every worker claims chunks from the
+            //   shared '_next_job' counter until it's exhausted, so variable-cost
+            //   patterns cannot leave one thread grinding through a long tail alone.
             thread_work_t* p_wrk = (thread_work_t*)calloc( 1, sizeof(thread_work_t) );
             p_wrk->pfx = 0;   //always initially 0
-            p_wrk->jobs = ( amount_to_generate ? (amount_to_generate / worker_threads) : UINT64_MAX );
-            p_wrk->counter = (i * p_wrk->jobs);   //at its place in line
-            // ^ ex: 100,000 jobs; 4 threads ==> 0-24,999; 25,000-49,999; etc.
-            if ( amount_to_generate && (i == (worker_threads-1)) ) {   //on the last thread in line...
-                // get the final difference between what was already alloc'd and what's left to do
-                p_wrk->jobs = amount_to_generate - (p_wrk->jobs * (worker_threads-1));
-            }
-            //printf( "WORK: |%lu jobs|  |%lu counter|\n", p_wrk->jobs, p_wrk->counter );
+            atomic_init( &(p_wrk->done), 0 );
 
             (*(pp_tctx+i))->p_work = p_wrk;
 
-            // Create the fuzzer contexts, one per thread.
-            //   No need for error context informstion since the above context creation worked.
-// TODO: Fix this once output chains are done to cycle through completely independent contexts in each thread
+            // Clone the parsed context, one per thread: the compiled pattern is
+            //   shared read-only while each worker gets private generator state.
             (*(pp_tctx+i))->p_work->p_fuzz_ctx =
-                Nanofuzz__new( p_pattern_contents, 10000, refill, &p_dummy_ctx );
+                Nanofuzz__clone( p_fuzz_ctx, 10000, refill );
 
             if ( NULL == (*(pp_tctx+i))->p_work->p_fuzz_ctx )
                 errx( 1, "Failed to create fuzzing context in worker thread #%lu. Aborting.\n", i );
 
-            Error__delete( p_dummy_ctx );
-
             // Create a thread attribute block for detached state.
             pthread_attr_t tattr;
             pthread_attr_init( &tattr );
             pthread_attr_setdetachstate( &tattr, 1 );
 
+            // Round-robin placement: the worker and its clone's refill producer
+            //   share one CPU, so every batch the worker pops was filled (and
+            //   first-touched) node-locally by its own producer.
+            if (  (app_flags & FLAG_AFFINITY) && affinity_cpu_count > 0  ) {
+                int cpu = affinity_cpus[i % affinity_cpu_count];
+
+                cpu_set_t set;
+                CPU_ZERO( &set );
+                CPU_SET( cpu, &set );
+                pthread_attr_setaffinity_np( &tattr, sizeof(cpu_set_t), &set );
+
+                Nanofuzz__pin_producers( (*(pp_tctx+i))->p_work->p_fuzz_ctx, cpu );
+            }
+
             // Create the pthread and save the pointer.
             memset( &((*(pp_tctx+i))->thread), 0, sizeof(pthread_t) );
 
@@ -475,11 +888,35 @@ int main( int argc, char* const argv[] ) {
             pthread_attr_destroy( &tattr );
         }
 
-        // Keep the main thread alive while the threads do their work.
-        while ( amount_generated < amount_to_generate || !amount_to_generate ) {
+        // Keep the main thread alive while the threads do their work, aggregating
+        //   the relaxed per-thread progress counters on demand.
+        for ( ; ; ) {
+            size_t done_total = 0;
+            for ( size_t i = 0; i < worker_threads; i++ )
+                done_total += atomic_load_explicit(
+                    &((*(pp_tctx+i))->p_work->done), memory_order_relaxed );
+
+            if ( amount_to_generate && done_total >= amount_to_generate )  break;
+
             usleep( 10000 );
         }
 
+        // Merge and dump every worker's counters BEFORE the work structures (which
+        //   hold the only references to the per-thread contexts) are torn down. The
+        //   detached refill producers may still tick their counters; the snapshot is
+        //   approximate by design since nothing on the hot path is atomic.
+        if ( (app_flags & FLAG_PRINT_STATS) ) {
+            nanofuzz_stats_t stats_total, stats_one;
+            Stats__reset( &stats_total );
+
+            for ( size_t i = 0; i < worker_threads; i++ ) {
+                Nanofuzz__get_stats( (*(pp_tctx+i))->p_work->p_fuzz_ctx, &stats_one );
+                Stats__merge( &stats_total, &stats_one );
+            }
+
+            Stats__print( stdout, &stats_total );
+        }
+
         // If the program gets here, clean up.
         for ( size_t i = 0; i < worker_threads; i++ ) {
             if ( NULL != *(pp_tctx+i) ) {
@@ -491,9 +928,23 @@ int main( int argc, char* const argv[] ) {
     }
 
 
-    // Free resource allocations. All done.
-    Nanofuzz__delete( p_fuzz_ctx );
+    // Wait for any still-queued output to reach the disk before tearing down contexts.
+    if ( (app_flags & (FLAG_WRITE_TO_FILE | FLAG_PACK_CORPUS)) )  __writer_finish();
+
+    // Dump the single-context statistics (threaded runs printed theirs above).
+    if (  (app_flags & FLAG_PRINT_STATS) && worker_threads <= 1  ) {
+        nanofuzz_stats_t stats;
+        Nanofuzz__get_stats( p_fuzz_ctx, &stats );
+        Stats__print( stdout, &stats );
+    }
+
+    // Free resource allocations. All done. In threaded mode the parent context's
+    //   factory is shared with the (detached, never-joined) worker clones, so it is
+    //   left for process teardown just like the per-thread contexts themselves.
+    if ( worker_threads <= 1 )
+        Nanofuzz__delete( p_fuzz_ctx );
     free( p_output_file );
+    free( p_corpus_file );
     free( p_pattern_contents );
 
 #ifdef FUNCTION_PROFILING
@@ -503,45 +954,45 @@ int main( int argc, char* const argv[] ) {
 
 
 
-// Threading function to generate fuzzer data from each thread, until there
-//   is no more work to do in the current context.
+// Threading function to generate fuzzer data from each thread. Workers claim
+//   chunks of job numbers from the shared counter until none remain (or forever,
+//   when no --limit is set), so threads which draw cheap items simply claim more.
 void* thread_do_work( void* p_work ) {
     thread_work_t* p_do = (thread_work_t*)p_work;
+    size_t done = 0;
 
-    // If the jobs count is UINT64_MAX, this will go on forever.
-    size_t howmany = p_do->jobs;
-    while ( howmany > 0 ) {
-        nanofuzz_data_t* p_data = Nanofuzz__get_next( p_do->p_fuzz_ctx );
+    for ( ; ; ) {
+        // Claim the next chunk of job numbers and clamp it to the limit, if any.
+        size_t chunk_start = atomic_fetch_add_explicit(
+            &_next_job, FUZZ_JOB_CHUNK, memory_order_relaxed );
+        size_t chunk_end = (chunk_start + FUZZ_JOB_CHUNK);
+
+        if ( amount_to_generate ) {
+            if ( chunk_start >= amount_to_generate )  break;
+            if ( chunk_end > amount_to_generate )  chunk_end = amount_to_generate;
+        }
 
-        if ( NULL != p_data ) {
-            if ( (app_flags & FLAG_WRITE_TO_FILE) ) {
-                 write_to_out_file(
-                    p_data,
-                    (p_do->counter + (p_do->jobs - howmany)),
-                    p_do->pfx
-                );
-            } else if ( (app_flags & FLAG_ECHO_OUTPUT) ) {
-                printf(  "%s\n", (const char*)(p_data->output)  );
+        for ( size_t gen_num = chunk_start; gen_num < chunk_end; gen_num++ ) {
+            nanofuzz_data_t* p_data = Nanofuzz__get_next( p_do->p_fuzz_ctx );
+
+            if ( NULL != p_data ) {
+                if ( (app_flags & (FLAG_WRITE_TO_FILE | FLAG_PACK_CORPUS)) ) {
+                     __writer_submit( p_do->p_fuzz_ctx, p_data, gen_num, p_do->pfx );
+                } else if ( (app_flags & FLAG_ECHO_OUTPUT) ) {
+                    printf(  "%s\n", (const char*)(p_data->output)  );
+                }
             }
-        }
 
-        if ( howmany < UINT64_MAX )  howmany--;
+            // Publish progress; only this thread ever writes its own counter.
+            done++;
+            atomic_store_explicit( &(p_do->done), done, memory_order_relaxed );
+        }
     }
 
-    thread_update_amount( p_do->jobs );
-
     return NULL;
 }
 
 
-// If the program is not running until infinity, increment the amount-generated counter.
-void thread_update_amount( size_t generated ) {
-    pthread_mutex_lock( &_amount_mutex );
-    amount_generated += generated;
-    pthread_mutex_unlock( &_amount_mutex );
-}
-
-
 
 static void register_signal_handlers() {
     static struct sigaction sa;
@@ -618,13 +1069,13 @@ static char* read_data_from_file( FILE* fp_file, bool gets_size ) {
 
 
 
-void write_to_out_file( nanofuzz_data_t* p_data, size_t gen_num, size_t pfx ) {
+// Expand the configured output filename template into 'p_filename' (PATH_MAX bytes,
+//   zeroed by the caller), substituting the iteration number at the first wildcard.
+static void __format_out_filename( char* p_filename, size_t gen_num, size_t pfx ) {
 
-    if ( NULL == p_output_file || NULL == p_data || 0 == p_data->length )  return;
+    if ( NULL == p_output_file )  return;
 
     char* const x = (char*)calloc( PATH_MAX, sizeof(char) );   //intermediate
-    char* const p_filename = (char*)calloc( PATH_MAX, sizeof(char) );
-    FILE* fp_out = NULL;
     char* asterisk = NULL;
 
     // Copy in the path name. It's done this way so the 'x' buffer can be larger.
@@ -653,125 +1104,592 @@ void write_to_out_file( nanofuzz_data_t* p_data, size_t gen_num, size_t pfx ) {
         memcpy( p_filename, x, strlen(x) );
     }
 
-    // Open the handle to the output file.
-    fp_out = fopen( p_filename, "wb" );
-    if ( NULL == fp_out ) {
-        fprintf( stderr, "Problem writing to output file at: '%s'\n", p_filename );
-        free( (void*)p_filename );
-        free( (void*)x );
+    free( (void*)x );
+}
+
+
+
+// Start the dedicated output writer thread (opening the corpus first, if packing).
+static void __writer_start() {
+    if ( (app_flags & FLAG_PACK_CORPUS) )  __corpus_open();
+
+    if (  pthread_create( &_writer_thread, NULL, __writer_thread_main, NULL )  )
+        errx( 1, "Failed to create the output writer thread. Aborting.\n" );
+}
+
+
+// Signal the writer that no more submissions are coming and wait for the
+//   submission queue to fully drain to disk.
+static void __writer_finish() {
+    pthread_mutex_lock( &_writer_mutex );
+    _writer_shutdown = true;
+    pthread_mutex_unlock( &_writer_mutex );
+
+    pthread_cond_signal( &_writer_nonempty );
+    pthread_join( _writer_thread, NULL );
+
+    // Every record is on disk now; seal the corpus with its index and trailer.
+    if ( (app_flags & FLAG_PACK_CORPUS) )  __corpus_close();
+}
+
+
+// Enqueue a generated item for the writer thread. Ownership of 'p_data' passes
+//   to the writer, which recycles it through the owning context once flushed.
+//   Blocks only when the submission queue is completely full (disk backpressure).
+static void __writer_submit(
+    nanofuzz_context_t* p_ctx, nanofuzz_data_t* p_data, size_t gen_num, size_t pfx
+) {
+    pthread_mutex_lock( &_writer_mutex );
+
+    while ( FUZZ_WRITER_QUEUE_DEPTH == _writer_pending )
+        pthread_cond_wait( &_writer_nonfull, &_writer_mutex );
+
+    write_job_t* p_job = &(_writer_queue[_writer_tail]);
+    p_job->p_fuzz_ctx = p_ctx;
+    p_job->p_data = p_data;
+    p_job->gen_num = gen_num;
+    p_job->pfx = pfx;
+
+    _writer_tail = ((_writer_tail + 1) % FUZZ_WRITER_QUEUE_DEPTH);
+    _writer_pending++;
+
+    pthread_mutex_unlock( &_writer_mutex );
+    pthread_cond_signal( &_writer_nonempty );
+}
+
+
+// Writer thread entry: repeatedly claim a window of queued jobs and flush it.
+static void* __writer_thread_main( void* p_arg ) {
+    write_job_t batch[FUZZ_WRITER_BATCH];
+
+    for ( ; ; ) {
+        size_t amount = 0;
+
+        pthread_mutex_lock( &_writer_mutex );
+        while ( 0 == _writer_pending && !_writer_shutdown )
+            pthread_cond_wait( &_writer_nonempty, &_writer_mutex );
+
+        if ( 0 == _writer_pending && _writer_shutdown ) {
+            pthread_mutex_unlock( &_writer_mutex );
+            break;
+        }
+
+        // Claim up to a full window of queued jobs, then release submitters.
+        while ( _writer_pending > 0 && amount < FUZZ_WRITER_BATCH ) {
+            batch[amount] = _writer_queue[_writer_head];
+            _writer_head = ((_writer_head + 1) % FUZZ_WRITER_QUEUE_DEPTH);
+            _writer_pending--;
+            amount++;
+        }
+
+        pthread_mutex_unlock( &_writer_mutex );
+        pthread_cond_broadcast( &_writer_nonfull );
+
+        __writer_flush_batch( &(batch[0]), amount );
+    }
+
+    return NULL;
+}
+
+
+// Persist a claimed window of jobs. The opens, writes, and closes are each issued
+//   as a clustered pass over the window rather than interleaving open/write/close
+//   per file, and raw descriptors skip the stdio buffering layer entirely.
+static void __writer_flush_batch( write_job_t* p_jobs, size_t amount ) {
+    // Only ever touched by the single writer thread.
+    static char filenames[FUZZ_WRITER_BATCH][PATH_MAX];
+    int fds[FUZZ_WRITER_BATCH];
+
+    // Packed corpus mode: the whole window becomes sequential appends into the
+    //   one open file; no opens, no closes, no per-item metadata operations.
+    if ( (app_flags & FLAG_PACK_CORPUS) ) {
+        for ( size_t i = 0; i < amount; i++ ) {
+            if ( NULL != p_jobs[i].p_data && p_jobs[i].p_data->length > 0 )
+                __corpus_append( p_jobs[i].p_data );
+
+            Nanofuzz__delete_data( p_jobs[i].p_fuzz_ctx, p_jobs[i].p_data );
+        }
         return;
     }
 
-    // Attempt to write the output to the handle.
-    size_t bytes_written = fwrite( p_data->output, sizeof(unsigned char),
-        p_data->length, fp_out );
+    // Pass 1: expand filenames and open every descriptor in the window.
+    for ( size_t i = 0; i < amount; i++ ) {
+        if ( NULL == p_jobs[i].p_data || 0 == p_jobs[i].p_data->length ) {
+            fds[i] = -1;
+            continue;
+        }
+
+        memset( &(filenames[i][0]), 0, PATH_MAX );
+        __format_out_filename( &(filenames[i][0]), p_jobs[i].gen_num, p_jobs[i].pfx );
+
+        fds[i] = open( &(filenames[i][0]), (O_WRONLY | O_CREAT | O_TRUNC), 0644 );
+        if ( -1 == fds[i] )
+            fprintf( stderr, "Problem writing to output file at: '%s'\n", &(filenames[i][0]) );
+    }
+
+    // Pass 2: issue the writes.
+    for ( size_t i = 0; i < amount; i++ ) {
+        if ( -1 == fds[i] )  continue;
 
-    if ( bytes_written != p_data->length )
-        fprintf( stderr, "Problem writing all output to file at: '%s'\n", p_filename );
+        nanofuzz_data_t* p_data = p_jobs[i].p_data;
 
-    fclose( fp_out );
-    free( (void*)p_filename );
-    free( (void*)x );
+        size_t written = 0;
+        while ( written < p_data->length ) {
+            ssize_t rc = write( fds[i],
+                ((const unsigned char*)(p_data->output) + written), (p_data->length - written) );
+
+            if ( rc <= 0 ) {
+                fprintf( stderr, "Problem writing all output to file at: '%s'\n", &(filenames[i][0]) );
+                break;
+            }
+
+            written += (size_t)rc;
+        }
+    }
+
+    // Pass 3: close the window and recycle the generated items.
+    for ( size_t i = 0; i < amount; i++ ) {
+        if ( -1 != fds[i] )  close( fds[i] );
 
+        if ( NULL != p_jobs[i].p_data )
+            Nanofuzz__delete_data( p_jobs[i].p_fuzz_ctx, p_jobs[i].p_data );
+    }
 }
 
 
 
-// Instrumentation and profiling.
-#ifdef FUNCTION_PROFILING
+// Open the packed corpus file, stamp its header, and hang a large stdio buffer
+//   behind it so appends coalesce into multi-MB sequential writes.
+static void __corpus_open() {
+    _corpus_fp = fopen( p_corpus_file, "wb" );
+    if ( NULL == _corpus_fp )
+        errx( 1, "Unable to open the packed corpus file at: '%s'\n", p_corpus_file );
 
-#define MAX_PROFILES 200
-#include <time.h>
+    setvbuf( _corpus_fp, NULL, _IOFBF, FUZZ_CORPUS_WRITE_BUFFER );
 
-typedef struct __callee_stats {
-    void* func;
-    double total_time;
-    size_t total_calls;
-    clock_t start_time;
-    pthread_mutex_t mutex;
-} callee_stats_t;
+    uint64_t magic = FUZZ_CORPUS_MAGIC;
+    uint64_t version = FUZZ_CORPUS_VERSION;
 
-static pthread_mutex_t stats_mutex
-    = PTHREAD_MUTEX_INITIALIZER;
+    if (
+           1 != fwrite( &magic, sizeof(uint64_t), 1, _corpus_fp )
+        || 1 != fwrite( &version, sizeof(uint64_t), 1, _corpus_fp )
+    )  errx( 1, "Problem writing the corpus header to: '%s'\n", p_corpus_file );
 
-static callee_stats_t stats[MAX_PROFILES];
-static size_t stats_count = 0;
+    _corpus_cursor = (2 * sizeof(uint64_t));
+}
 
 
-__attribute__((no_instrument_function))
-static inline int __cyg_profile_find_fn( void* fnptr ) {
-    size_t idx = 0;
+// Append one generated output to the corpus as a length-prefixed record, noting
+//   its offset for the trailing index and checkpointing durability periodically.
+static void __corpus_append( const nanofuzz_data_t* p_data ) {
+    if ( NULL == _corpus_fp )  return;
 
-    for (
-        callee_stats_t* p = &(stats[0]);
-        p < (stats + MAX_PROFILES);
-        p++
+    // Grow the offset index as needed; it only ever lives until the close below.
+    if ( _corpus_count == _corpus_capacity ) {
+        size_t next = ( _corpus_capacity > 0 ) ? (_corpus_capacity * 2) : 4096;
+        uint64_t* p_new = (uint64_t*)realloc( _corpus_offsets, (next * sizeof(uint64_t)) );
+        if ( NULL == p_new )
+            errx( 1, "Out of memory growing the corpus offset index.\n" );
+
+        _corpus_offsets = p_new;
+        _corpus_capacity = next;
+    }
+
+    _corpus_offsets[_corpus_count] = _corpus_cursor;
+
+    uint32_t reclen = (uint32_t)(p_data->length);
+    if (
+           1 != fwrite( &reclen, sizeof(uint32_t), 1, _corpus_fp )
+        || p_data->length != fwrite( p_data->output, sizeof(char), p_data->length, _corpus_fp )
     ) {
-        if ( fnptr == p->func )
-            return idx;
+        fprintf( stderr, "Problem appending a record to the corpus at: '%s'\n", p_corpus_file );
+        return;
+    }
+
+    _corpus_cursor += (sizeof(uint32_t) + p_data->length);
+    _corpus_count++;
 
-        idx++;
+    // Periodic checkpoint: everything appended so far survives a later crash.
+    if ( 0 == (_corpus_count % FUZZ_CORPUS_CHECKPOINT) ) {
+        fflush( _corpus_fp );
+        fsync( fileno( _corpus_fp ) );
     }
+}
+
 
-    return -1;
+// Seal the corpus: write the offset index and the locating trailer, then sync.
+static void __corpus_close() {
+    if ( NULL == _corpus_fp )  return;
+
+    uint64_t index_offset = _corpus_cursor;
+    uint64_t count = (uint64_t)_corpus_count;
+    uint64_t magic = FUZZ_CORPUS_MAGIC;
+
+    if (
+           _corpus_count != fwrite( _corpus_offsets, sizeof(uint64_t), _corpus_count, _corpus_fp )
+        || 1 != fwrite( &index_offset, sizeof(uint64_t), 1, _corpus_fp )
+        || 1 != fwrite( &count, sizeof(uint64_t), 1, _corpus_fp )
+        || 1 != fwrite( &magic, sizeof(uint64_t), 1, _corpus_fp )
+    )  fprintf( stderr, "Problem writing the corpus index to: '%s'\n", p_corpus_file );
+
+    fflush( _corpus_fp );
+    fsync( fileno( _corpus_fp ) );
+    fclose( _corpus_fp );
+    _corpus_fp = NULL;
+
+    free( _corpus_offsets );
+    _corpus_offsets = NULL;
+
+    printf( "Packed %lu records into corpus '%s'.\n",
+        (unsigned long)_corpus_count, p_corpus_file );
 }
 
 
+// Copy one record's payload from the corpus stream to the destination in chunks.
+static void __corpus_copy_record( FILE* fp_corpus, uint64_t length, FILE* fp_dest ) {
+    static unsigned char chunk[1 << 16];
 
-void __cyg_profile_func_enter( void* callee, void* caller ) {
-    // See if a struct exists for this fptr.
-    callee_stats_t* p_stats = NULL;
+    while ( length > 0 ) {
+        size_t step = ( length < sizeof(chunk) ) ? (size_t)length : sizeof(chunk);
+
+        if (
+               step != fread( chunk, sizeof(unsigned char), step, fp_corpus )
+            || step != fwrite( chunk, sizeof(unsigned char), step, fp_dest )
+        )  errx( 1, "Problem copying a corpus record; the file may be truncated.\n" );
+
+        length -= step;
+    }
+}
 
-    int idx = __cyg_profile_find_fn( callee );
-    if (  -1 == idx && stats_count < MAX_PROFILES  ) {
-        p_stats = (callee_stats_t*)calloc( 1, sizeof(callee_stats_t) );
-        p_stats->func = callee;
-        p_stats->total_time = 0;
-        p_stats->total_calls = 0;
 
-        pthread_mutex_init( &(p_stats->mutex), NULL );
+// Pull record #'index' (or every record, with 'all') back out of a packed corpus.
+//   Indexed files are random-access through the trailer; files cut short before
+//   the index landed are recovered by walking the length prefixes sequentially.
+static void __corpus_extract( const char* p_path, uint64_t index, bool all ) {
+    FILE* fp = fopen( p_path, "rb" );
+    if ( NULL == fp )
+        errx( 1, "Unable to open the packed corpus file at: '%s'\n", p_path );
+
+    uint64_t magic = 0, version = 0;
+    if (
+           1 != fread( &magic, sizeof(uint64_t), 1, fp )
+        || 1 != fread( &version, sizeof(uint64_t), 1, fp )
+        || FUZZ_CORPUS_MAGIC != magic
+        || FUZZ_CORPUS_VERSION != version
+    )  errx( 1, "The file at '%s' is not a (compatible) packed nanofuzz corpus.\n", p_path );
+
+    errno = 0;
+    fseek( fp, 0L, SEEK_END );
+    long file_size = ftell( fp );
+    if ( errno || file_size < 0 )
+        errx( 1, "Unable to measure the corpus file at: '%s'\n", p_path );
+
+    // Look for the sealing trailer; its absence just means a sequential walk below.
+    uint64_t index_offset = 0, count = 0;
+    bool have_index = false;
+
+    if ( file_size >= (long)((2 + 3) * sizeof(uint64_t)) ) {
+        uint64_t trailer_magic = 0;
+
+        fseek( fp, (file_size - (3 * sizeof(uint64_t))), SEEK_SET );
+        if (
+               1 == fread( &index_offset, sizeof(uint64_t), 1, fp )
+            && 1 == fread( &count, sizeof(uint64_t), 1, fp )
+            && 1 == fread( &trailer_magic, sizeof(uint64_t), 1, fp )
+            && FUZZ_CORPUS_MAGIC == trailer_magic
+            && (long)(index_offset + (count * sizeof(uint64_t)) + (3 * sizeof(uint64_t))) == file_size
+        )  have_index = true;
+    }
 
-        pthread_mutex_lock( &stats_mutex );
+    // Records end where the index begins (or at EOF when no index ever landed).
+    uint64_t data_end = have_index ? index_offset : (uint64_t)file_size;
 
-        memcpy( &(stats[stats_count]), p_stats, sizeof(callee_stats_t) );
-        free( p_stats );
-        p_stats = &(stats[stats_count]);
+    if ( !all && have_index ) {
+        if ( index >= count )
+            errx( 1, "Record %lu is out of range; the corpus holds %lu records.\n",
+                (unsigned long)index, (unsigned long)count );
 
-        stats_count++;
+        // Random access straight through the trailer's offset index.
+        uint64_t offset = 0;
+        fseek( fp, (index_offset + (index * sizeof(uint64_t))), SEEK_SET );
+        if ( 1 != fread( &offset, sizeof(uint64_t), 1, fp ) )
+            errx( 1, "Problem reading the corpus index at: '%s'\n", p_path );
 
-        pthread_mutex_unlock( &stats_mutex );
-    } else {
-        p_stats = &(stats[idx]);
+        fseek( fp, offset, SEEK_SET );
+    }
+
+    // Walk (or directly read) the records, emitting the requested one(s).
+    uint64_t cursor = ( !all && have_index ) ? 0 : (2 * sizeof(uint64_t));
+    uint64_t record = 0;
+    bool found = false;
+
+    if ( all || !have_index )
+        fseek( fp, cursor, SEEK_SET );   //back to the first record; trailer probing moved us
+
+    for ( ; ; ) {
+        if ( (all || !have_index) && (cursor + sizeof(uint32_t)) > data_end )
+            break;
+
+        uint32_t reclen = 0;
+        if ( 1 != fread( &reclen, sizeof(uint32_t), 1, fp ) )
+            break;
+
+        if ( (all || !have_index) && (cursor + sizeof(uint32_t) + reclen) > data_end )
+            break;   //partial tail record from an interrupted run
+
+        if ( all ) {
+            // Expand each record through the '-o' wildcard template.
+            static char filename[PATH_MAX];
+            memset( &(filename[0]), 0, PATH_MAX );
+            __format_out_filename( &(filename[0]), (size_t)record, 0 );
+
+            FILE* fp_out = fopen( filename, "wb" );
+            if ( NULL == fp_out )
+                errx( 1, "Problem writing to output file at: '%s'\n", filename );
+
+            __corpus_copy_record( fp, (uint64_t)reclen, fp_out );
+            fclose( fp_out );
+            found = true;
+        } else if ( have_index || record == index ) {
+            FILE* fp_out = stdout;
+
+            if ( (app_flags & FLAG_WRITE_TO_FILE) ) {
+                static char filename[PATH_MAX];
+                memset( &(filename[0]), 0, PATH_MAX );
+                __format_out_filename( &(filename[0]), (size_t)index, 0 );
+
+                fp_out = fopen( filename, "wb" );
+                if ( NULL == fp_out )
+                    errx( 1, "Problem writing to output file at: '%s'\n", filename );
+            }
+
+            __corpus_copy_record( fp, (uint64_t)reclen, fp_out );
+
+            if ( stdout != fp_out )  fclose( fp_out );
+            else  fflush( stdout );
+
+            found = true;
+            break;
+        } else {
+            // Not the record we want yet; hop over its payload.
+            fseek( fp, reclen, SEEK_CUR );
+        }
+
+        cursor += (sizeof(uint32_t) + reclen);
+        record++;
     }
 
-    clock_t start_time = clock();
+    fclose( fp );
 
-    pthread_mutex_lock( &(p_stats->mutex) );
-    p_stats->start_time = start_time;
-    pthread_mutex_unlock( &(p_stats->mutex) );
+    if ( !found )
+        errx( 1, "Record %lu was not found in the corpus at: '%s'\n",
+            (unsigned long)index, p_path );
+
+    if ( all )
+        printf( "Extracted %lu records from corpus '%s'.\n",
+            (unsigned long)record, p_path );
 }
 
-void __cyg_profile_func_exit( void* callee, void* caller ) {
-    clock_t end_time = clock();   //get the end time and hold until the mutex releases
 
-    int idx = __cyg_profile_find_fn( callee );
-    if ( -1 != idx ) {
-        callee_stats_t* p_stats = &(stats[idx]);
 
-        pthread_mutex_lock( &(p_stats->mutex) );
-        p_stats->total_time += ((double)(end_time - p_stats->start_time) / CLOCKS_PER_SEC);
-        p_stats->total_calls++;
-        pthread_mutex_unlock( &(p_stats->mutex) );
+// Instrumentation and profiling.
+//   The hooks below run on EVERY function entry and exit, so the cardinal rule is
+//   that they must not perturb what they measure: no locks, no allocation, and no
+//   shared cache lines on the hot path. Each thread claims a private table from a
+//   static pool on its first sample and then counts/times completely alone; the
+//   tables are only read by the merge pass at exit. Per-thread CPU clocks are used
+//   so one thread's timings are never polluted by another's scheduling.
+#ifdef FUNCTION_PROFILING
+
+#include <time.h>
+
+// Per-thread open-addressing table size (power of two) and probe cap. Slots key on
+//   the (callee, caller) EDGE, so the merged report can show who drove a hot path.
+#define PROF_TABLE_SIZE 2048
+#define PROF_PROBE_LIMIT 32
+// Shadow-stack depth for attributing elapsed time to the matching entry hook.
+#define PROF_STACK_DEPTH 512
+// Maximum threads which can hold profiling tables; later threads drop samples.
+#define PROF_MAX_THREADS 64
+
+typedef struct __prof_edge {
+    void* callee;
+    void* caller;
+    uint64_t calls;
+    double total_time;
+} prof_edge_t;
+
+typedef struct __prof_frame {
+    prof_edge_t* p_edge;
+    struct timespec start;
+} prof_frame_t;
+
+// The table pool is static (NOT thread-local) so the exit-time merge can still
+//   read tables whose owning threads have already finished and torn down their TLS.
+static prof_edge_t _prof_tables[PROF_MAX_THREADS][PROF_TABLE_SIZE];
+static _Atomic size_t _prof_thread_count = 0;
+
+// The only thread-local state: which pool slot this thread owns, plus its shadow
+//   stack of in-flight calls. Single-owner, so none of it needs atomics.
+static __thread prof_edge_t* _prof_table = NULL;
+static __thread prof_frame_t _prof_stack[PROF_STACK_DEPTH];
+static __thread size_t _prof_depth = 0;
+
+
+// Find (or claim) this thread's counter slot for a call edge. Returns NULL when
+//   the sample must be dropped (thread pool or table exhausted); dropping beats
+//   blocking, since a stalled hook would distort every number around it.
+__attribute__((no_instrument_function))
+static inline prof_edge_t* __prof_edge_slot( void* callee, void* caller ) {
+    if ( NULL == _prof_table ) {
+        size_t mine = atomic_fetch_add_explicit(
+            &_prof_thread_count, 1, memory_order_relaxed );
+        if ( mine >= PROF_MAX_THREADS )  return NULL;
+
+        _prof_table = &(_prof_tables[mine][0]);
+    }
+
+    // Fibonacci-mix the two pointers together; linear probe from there.
+    uintptr_t h = ( (uintptr_t)callee ^ ((uintptr_t)caller >> 3) )
+        * (uintptr_t)0x9E3779B97F4A7C15UL;
+    size_t idx = ( (size_t)(h >> 16) & (PROF_TABLE_SIZE - 1) );
+
+    for ( size_t probe = 0; probe < PROF_PROBE_LIMIT; probe++ ) {
+        prof_edge_t* p_edge = &(_prof_table[(idx + probe) & (PROF_TABLE_SIZE - 1)]);
+
+        if ( callee == p_edge->callee && caller == p_edge->caller )
+            return p_edge;
+
+        if ( NULL == p_edge->callee ) {
+            // Unclaimed slot; the table is private, so just take it.
+            p_edge->callee = callee;
+            p_edge->caller = caller;
+            return p_edge;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Count one traversal of a call edge without timing it. This is the primitive the
+//   NANOFUZZ_STATS_PRE instrumentation declares for external code-path tracking.
+void __nanofuzz_register_function_call( void* callee, void* caller ) {
+    prof_edge_t* p_edge = __prof_edge_slot( callee, caller );
+    if ( NULL != p_edge )
+        p_edge->calls++;
+}
+
+
+void __cyg_profile_func_enter( void* callee, void* caller ) {
+    prof_edge_t* p_edge = __prof_edge_slot( callee, caller );
+    if ( NULL != p_edge )
+        p_edge->calls++;
+
+    // Push a shadow frame so the exit hook can attribute elapsed time; past the
+    //   depth cap the call is still counted, just not timed. The depth ALWAYS
+    //   moves in lockstep with the real stack: a dropped sample (no edge slot)
+    //   records an untimed frame instead of desynchronizing every frame above it.
+    if ( _prof_depth < PROF_STACK_DEPTH ) {
+        prof_frame_t* p_frame = &(_prof_stack[_prof_depth]);
+        p_frame->p_edge = p_edge;
+        if ( NULL != p_edge )
+            clock_gettime( CLOCK_THREAD_CPUTIME_ID, &(p_frame->start) );
     }
+    _prof_depth++;
+}
+
+void __cyg_profile_func_exit( void* callee, void* caller ) {
+    if ( 0 == _prof_depth )  return;
+
+    _prof_depth--;
+    if ( _prof_depth >= PROF_STACK_DEPTH )  return;   //untimed overflow frame
+
+    prof_frame_t* p_frame = &(_prof_stack[_prof_depth]);
+    if ( NULL == p_frame->p_edge )  return;   //untimed dropped-sample frame
+
+    struct timespec end;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &end );
+
+    p_frame->p_edge->total_time +=
+        (double)(end.tv_sec - (p_frame->start).tv_sec)
+        + ((double)(end.tv_nsec - (p_frame->start).tv_nsec) / 1e9);
 }
 
 
 #undef printf
+// Merge every thread's private table into one report. Per-callee lines keep the
+//   historical '|callee| --> time --> calls' shape tests/profiling.py parses;
+//   the edge section after them breaks the same totals down by caller.
 void __profiling_print_stats() {
-    printf( "\nAPPLICATION PROFILING STATISTICS:\n" );
-    for ( size_t x = 0; x < stats_count; x++ ) {
+    size_t tables = atomic_load_explicit( &_prof_thread_count, memory_order_acquire );
+    if ( tables > PROF_MAX_THREADS )  tables = PROF_MAX_THREADS;
+
+    // Aggregate by callee with the same open-addressing scheme the hooks use.
+    static prof_edge_t merged[PROF_TABLE_SIZE];
+    memset( &(merged[0]), 0, sizeof(merged) );
+
+    for ( size_t t = 0; t < tables; t++ ) {
+        for ( size_t s = 0; s < PROF_TABLE_SIZE; s++ ) {
+            prof_edge_t* p_edge = &(_prof_tables[t][s]);
+            if ( NULL == p_edge->callee )  continue;
+
+            uintptr_t h = (uintptr_t)p_edge->callee * (uintptr_t)0x9E3779B97F4A7C15UL;
+            for ( size_t probe = 0; probe < PROF_TABLE_SIZE; probe++ ) {
+                prof_edge_t* p_sum =
+                    &(merged[((size_t)(h >> 16) + probe) & (PROF_TABLE_SIZE - 1)]);
+
+                if ( NULL == p_sum->callee )  p_sum->callee = p_edge->callee;
+                if ( p_sum->callee != p_edge->callee )  continue;
+
+                p_sum->calls += p_edge->calls;
+                p_sum->total_time += p_edge->total_time;
+                break;
+            }
+        }
+    }
+
+    printf( "\nAPPLICATION PROFILING STATISTICS (%lu threads):\n", tables );
+    for ( size_t s = 0; s < PROF_TABLE_SIZE; s++ ) {
+        if ( NULL == merged[s].callee )  continue;
         printf( "\t|%p| --> %.4fs --> %lu\n",
-            stats[x].func, stats[x].total_time, stats[x].total_calls );
+            merged[s].callee, merged[s].total_time, merged[s].calls );
+    }
+
+    // Second pass: fold identical edges from different threads together.
+    static prof_edge_t merged_edges[PROF_TABLE_SIZE];
+    memset( &(merged_edges[0]), 0, sizeof(merged_edges) );
+
+    for ( size_t t = 0; t < tables; t++ ) {
+        for ( size_t s = 0; s < PROF_TABLE_SIZE; s++ ) {
+            prof_edge_t* p_edge = &(_prof_tables[t][s]);
+            if ( NULL == p_edge->callee )  continue;
+
+            uintptr_t h = ( (uintptr_t)p_edge->callee ^ ((uintptr_t)p_edge->caller >> 3) )
+                * (uintptr_t)0x9E3779B97F4A7C15UL;
+            for ( size_t probe = 0; probe < PROF_TABLE_SIZE; probe++ ) {
+                prof_edge_t* p_sum =
+                    &(merged_edges[((size_t)(h >> 16) + probe) & (PROF_TABLE_SIZE - 1)]);
+
+                if ( NULL == p_sum->callee ) {
+                    p_sum->callee = p_edge->callee;
+                    p_sum->caller = p_edge->caller;
+                }
+                if (  p_sum->callee != p_edge->callee || p_sum->caller != p_edge->caller  )
+                    continue;
+
+                p_sum->calls += p_edge->calls;
+                p_sum->total_time += p_edge->total_time;
+                break;
+            }
+        }
+    }
+
+    printf( "\nAPPLICATION PROFILING EDGES:\n" );
+    for ( size_t s = 0; s < PROF_TABLE_SIZE; s++ ) {
+        if ( NULL == merged_edges[s].callee )  continue;
+        printf( "\t|%p| <-- |%p| ==> %lu\n",
+            merged_edges[s].callee, merged_edges[s].caller, merged_edges[s].calls );
     }
     printf( "\n\n" );
 }
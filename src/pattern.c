@@ -6,9 +6,6 @@
  */
 
 #include "pattern.h"
-#include "generator.h"
-
-#include <yallic.h>
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -16,6 +13,10 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 
@@ -25,10 +26,16 @@ typedef struct _fuzz_parser_ctx_t {
     // Tracks an overall context's nesting hierarchy; entry points for each layer as it builds.
     //   These values are intended to be ephemeral pointers used just while building the factory.
     fuzz_pattern_block_t** p_nest_tracker;
+    // Position of each tracked block within its frame's block sequence. Maintained as
+    //   blocks are appended so branch and repetition bookkeeping never rescans the sequence.
+    size_t* p_nest_tracker_idx;
     // Tracks the index into the above, preventing over-complexity of input patterns.
     size_t nest_level;
     // Array of subcontexts.
     fuzz_subcontext_t subcontexts[FUZZ_MAX_SUBCONTEXTS];
+    // Structural hash of each declared subcontext's compiled program, index-aligned
+    //   with the above. Used to intern structurally identical variable bodies.
+    unsigned long subfactory_hashes[FUZZ_MAX_SUBCONTEXTS];
     // Amount of references declared as subcontexts.
     size_t subcontexts_count;
     // Context-dependent pattern error handler.
@@ -37,12 +44,30 @@ typedef struct _fuzz_parser_ctx_t {
 
 
 
+// Growable, index-addressed sequence of pattern block pointers staged during parsing.
+//   Positions are recorded as blocks are appended, so nothing ever has to scan the
+//   structure to locate a node: large schemas parse in linear time.
+typedef struct _fuzz_block_seq_t {
+    fuzz_pattern_block_t** pp_blocks;   // staged block pointers, in program order
+    size_t count;      // amount of blocks currently staged
+    size_t capacity;   // allocated pointer slots
+} fuzz_block_seq_t;
+
+// Sentinel stored in a nest-tracker index slot when the tracked pointer (if any)
+//   does not belong to the CURRENT frame's sequence (e.g. leftover from a sibling
+//   subsequence at the same nesting depth).
+#define FUZZ_BLOCK_SEQ_UNTRACKED ((size_t)-1)
+
+
+
 // Some [important] local static functions.
 static inline int __bracket_parse_range( fuzz_pattern_block_t* const p_block, const char* p_content, int comma );
 static inline int __range_parse_range( fuzz_pattern_block_t* const p_pattern_block, const char** pp_content );
-static int __branch_write_end( List_t* p_seq, fuzz_pattern_block_t* p_branch_root_block,
-    fuzz_parser_ctx_t* const p_ctx, int is_post_run );
-static List_t* __parse_pattern( fuzz_parser_ctx_t* const p_ctx, const char* p_pattern );
+static int __branch_write_end( fuzz_block_seq_t* p_seq, fuzz_pattern_block_t* p_branch_root_block,
+    size_t root_index, fuzz_parser_ctx_t* const p_ctx, int is_post_run );
+static uint16_t __get_valid_uint16( const char* p_str );
+static fuzz_block_seq_t* __parse_pattern( fuzz_parser_ctx_t* const p_ctx, const char* p_pattern );
+static void __pattern_block_free_operand( fuzz_pattern_block_t* p_block );
 
 
 
@@ -96,6 +121,8 @@ static inline fuzz_parser_ctx_t* const __ParserContext__new() {
 
     p_ctx->p_nest_tracker = (fuzz_pattern_block_t**)calloc(
         FUZZ_MAX_NESTING_COMPLEXITY, sizeof(fuzz_pattern_block_t*) );
+    p_ctx->p_nest_tracker_idx = (size_t*)calloc(
+        FUZZ_MAX_NESTING_COMPLEXITY, sizeof(size_t) );
     p_ctx->nest_level = 0;
     p_ctx->p_err = Error__new();
 
@@ -110,9 +137,17 @@ static inline void __ParserContext__delete( fuzz_parser_ctx_t* const p, fuzz_err
             p->p_nest_tracker = NULL;
         }
 
+        if ( p->p_nest_tracker_idx ) {
+            free( p->p_nest_tracker_idx );
+            p->p_nest_tracker_idx = NULL;
+        }
+
         if ( p->subcontexts_count > 0 ) {
-            for ( size_t i = 0; i < p->subcontexts_count; i++ )
-                Generator__delete_context(  (p->subcontexts[i]).p_gen_ctx  );
+            for ( size_t i = 0; i < p->subcontexts_count; i++ ) {
+                // Interned slots alias a canonical slot's factory; don't double-free.
+                if ( i == (p->subcontexts[i]).intern_of )
+                    PatternFactory__delete(  (p->subcontexts[i]).p_factory  );
+            }
         }
 
         if (  NULL != p->p_err && 0 == Error__has_error( p->p_err )  ) {
@@ -128,13 +163,396 @@ static inline void __ParserContext__delete( fuzz_parser_ctx_t* const p, fuzz_err
 
 
 
-// Compress the contents of a pattern block list into a single calloc and set it in the factory.
-static fuzz_factory_t* __compress_List_to_factory( List_t* p_list ) {
-    if ( NULL == p_list )  return NULL;
+// Create an empty block sequence.
+static fuzz_block_seq_t* __blockseq_new() {
+    fuzz_block_seq_t* p_seq = (fuzz_block_seq_t*)calloc( 1, sizeof(fuzz_block_seq_t) );
+    if ( NULL == p_seq )  return NULL;
+
+    p_seq->capacity = 64;
+    p_seq->pp_blocks = (fuzz_pattern_block_t**)calloc(
+        p_seq->capacity, sizeof(fuzz_pattern_block_t*) );
+
+    if ( NULL == p_seq->pp_blocks ) {
+        free( p_seq );
+        return NULL;
+    }
+
+    return p_seq;
+}
+
+// Grow a sequence's pointer storage by doubling until it can hold 'needed' entries.
+//   The pattern-length ceiling bounds how many blocks a schema can ever stage.
+static int __blockseq_reserve( fuzz_block_seq_t* p_seq, size_t needed ) {
+    if ( needed <= p_seq->capacity )  return 0;
+    if ( needed > FUZZ_MAX_PATTERN_LENGTH )  return -1;
+
+    size_t new_capacity = p_seq->capacity;
+    while ( new_capacity < needed )  new_capacity <<= 1;
+
+    fuzz_pattern_block_t** pp_blocks = (fuzz_pattern_block_t**)realloc(
+        p_seq->pp_blocks, (new_capacity * sizeof(fuzz_pattern_block_t*)) );
+    if ( NULL == pp_blocks )  return -1;
+
+    p_seq->pp_blocks = pp_blocks;
+    p_seq->capacity = new_capacity;
+    return 0;
+}
+
+// Append a block onto the end of a sequence. Returns -1 on any failure.
+static int __blockseq_add( fuzz_block_seq_t* p_seq, fuzz_pattern_block_t* p_block ) {
+    if (  NULL == p_seq || -1 == __blockseq_reserve( p_seq, (p_seq->count + 1) )  )
+        return -1;
+
+    *((p_seq->pp_blocks)+(p_seq->count)) = p_block;
+    (p_seq->count)++;
+    return 0;
+}
+
+// Insert a block at 'index', shifting every later entry up one slot. Returns -1 on failure.
+static int __blockseq_add_at( fuzz_block_seq_t* p_seq, fuzz_pattern_block_t* p_block, size_t index ) {
+    if (
+           NULL == p_seq
+        || index > p_seq->count
+        || -1 == __blockseq_reserve( p_seq, (p_seq->count + 1) )
+    )  return -1;
+
+    memmove( ((p_seq->pp_blocks)+index+1), ((p_seq->pp_blocks)+index),
+        ((p_seq->count - index) * sizeof(fuzz_pattern_block_t*)) );
+
+    *((p_seq->pp_blocks)+index) = p_block;
+    (p_seq->count)++;
+    return 0;
+}
+
+// Peek the most recently staged block, or NULL when the sequence is empty.
+static fuzz_pattern_block_t* __blockseq_last( fuzz_block_seq_t* p_seq ) {
+    if ( NULL == p_seq || p_seq->count < 1 )  return NULL;
+    return *((p_seq->pp_blocks)+(p_seq->count - 1));
+}
+
+// Detach and return the most recently staged block, or NULL when empty.
+static fuzz_pattern_block_t* __blockseq_remove_last( fuzz_block_seq_t* p_seq ) {
+    if ( NULL == p_seq || p_seq->count < 1 )  return NULL;
+
+    (p_seq->count)--;
+    return *((p_seq->pp_blocks)+(p_seq->count));
+}
+
+// Staple every pointer from 'p_src' onto the end of 'p_dest' (shallow). -1 on failure.
+static int __blockseq_extend( fuzz_block_seq_t* p_dest, fuzz_block_seq_t* p_src ) {
+    if (
+           NULL == p_dest
+        || NULL == p_src
+        || -1 == __blockseq_reserve( p_dest, (p_dest->count + p_src->count) )
+    )  return -1;
+
+    memcpy( ((p_dest->pp_blocks)+(p_dest->count)), p_src->pp_blocks,
+        (p_src->count * sizeof(fuzz_pattern_block_t*)) );
+
+    p_dest->count += p_src->count;
+    return 0;
+}
+
+// Free the sequence container only; the staged blocks live on elsewhere.
+static void __blockseq_delete_shallow( fuzz_block_seq_t* p_seq ) {
+    if ( NULL == p_seq )  return;
+
+    free( p_seq->pp_blocks );
+    free( p_seq );
+}
+
+// Free the sequence along with every staged block and its operand allocations.
+static void __blockseq_delete_deep( fuzz_block_seq_t* p_seq ) {
+    if ( NULL == p_seq )  return;
+
+    for ( size_t i = 0; i < p_seq->count; i++ ) {
+        fuzz_pattern_block_t* p_block = *((p_seq->pp_blocks)+i);
+
+        if ( NULL != p_block ) {
+            __pattern_block_free_operand( p_block );
+            free( p_block );
+        }
+    }
+
+    __blockseq_delete_shallow( p_seq );
+}
+
+
+
+// Decide whether a block is a static string emitted exactly once; only these
+//   are candidates for the fusion peephole below.
+static inline int __block_is_fusible_string( fuzz_pattern_block_t* p_block ) {
+    return (
+           string == p_block->type
+        && 0 != (p_block->count).single
+        && 1 == (p_block->count).base
+    );
+}
+
+// Peephole pass over the finished node sequence: fuse runs of adjacent single-count
+//   'string' blocks into one pre-concatenated block. Most schemas are dominated by
+//   static text, so this collapses long instruction runs into a handful of memcpys
+//   at generation time. Because 'ret' and branch offsets are node-relative, every
+//   jump target is computed up front and used both to break runs (a target may
+//   never be swallowed into a predecessor) and to relocate offsets afterward.
+//   The pass is an optimization only: on any allocation failure it leaves the
+//   sequence untouched.
+static void __fuse_adjacent_strings( fuzz_factory_t* p_factory ) {
+    if ( NULL == p_factory || p_factory->count < 3 )  return;
+
+    fuzz_pattern_block_t* p_blocks = (fuzz_pattern_block_t*)(p_factory->node_seq);
+    size_t count = p_factory->count;
+
+    unsigned char* p_is_target = (unsigned char*)calloc( count, sizeof(unsigned char) );
+    size_t* p_remap = (size_t*)calloc( count, sizeof(size_t) );   // old index -> new index
+    size_t* p_old_of = (size_t*)calloc( count, sizeof(size_t) );   // new index -> old index
+
+    if ( NULL == p_is_target || NULL == p_remap || NULL == p_old_of )
+        goto __fuse_bail;
+
+    // Pass 1: mark every node which is the target of a relative jump.
+    for ( size_t i = 0; i < count; i++ ) {
+        switch ( p_blocks[i].type ) {
+            case ret : {
+                if ( p_blocks[i].operand.step <= i )
+                    p_is_target[i - p_blocks[i].operand.step] = 1;
+                break;
+            }
+            case branch_jmp : {
+                if ( (i + p_blocks[i].operand.step) < count )
+                    p_is_target[i + p_blocks[i].operand.step] = 1;
+                break;
+            }
+            case branch_root : {
+                fuzz_branch_root_t* p_root = p_blocks[i].operand.p_branch;
+                for ( size_t s = 0; NULL != p_root && s <= p_root->amount; s++ ) {
+                    if ( (i + p_root->steps[s]) < count )
+                        p_is_target[i + p_root->steps[s]] = 1;
+                }
+                break;
+            }
+            default : break;
+        }
+    }
+
+    // Pass 2: compact the sequence in place, concatenating each eligible run.
+    size_t w = 0;
+    for ( size_t r = 0; r < count; ) {
+        if ( __block_is_fusible_string( &(p_blocks[r]) ) ) {
+            // Greedily extend the run; a jump target always terminates it.
+            size_t j = (r + 1);
+            size_t total = p_blocks[r].operand.str.length;
+            while (
+                   j < count
+                && __block_is_fusible_string( &(p_blocks[j]) )
+                && !p_is_target[j]
+            ) {
+                total += p_blocks[j].operand.str.length;
+                j++;
+            }
+
+            if ( j > (r + 1) ) {
+                char* p_cat = (char*)calloc( (total + 1), sizeof(char) );
+                if ( NULL == p_cat )
+                    goto __fuse_bail;
+
+                char* p_scroll = p_cat;
+                for ( size_t k = r; k < j; k++ ) {
+                    memcpy( p_scroll, p_blocks[k].operand.str.p_str,
+                        p_blocks[k].operand.str.length );
+                    p_scroll += p_blocks[k].operand.str.length;
+
+                    free( p_blocks[k].operand.str.p_str );
+                    p_remap[k] = w;
+                }
+
+                p_blocks[w] = p_blocks[r];
+                p_blocks[w].operand.str.p_str = p_cat;
+                p_blocks[w].operand.str.length = total;
+                p_old_of[w] = r;
+
+                w++;
+                r = j;
+                continue;
+            }
+        }
+
+        p_remap[r] = w;
+        p_old_of[w] = r;
+        p_blocks[w] = p_blocks[r];
+        w++;
+        r++;
+    }
+
+    // Pass 3: relocate every node-relative offset through the remap table.
+    for ( size_t n = 0; n < w; n++ ) {
+        switch ( p_blocks[n].type ) {
+            case ret : {
+                size_t target_old = (p_old_of[n] - p_blocks[n].operand.step);
+                p_blocks[n].operand.step = (n - p_remap[target_old]);
+                break;
+            }
+            case branch_jmp : {
+                size_t target_old = (p_old_of[n] + p_blocks[n].operand.step);
+                if ( target_old < count )
+                    p_blocks[n].operand.step = (p_remap[target_old] - n);
+                break;
+            }
+            case branch_root : {
+                fuzz_branch_root_t* p_root = p_blocks[n].operand.p_branch;
+                for ( size_t s = 0; NULL != p_root && s <= p_root->amount; s++ ) {
+                    size_t target_old = (p_old_of[n] + p_root->steps[s]);
+                    if ( target_old < count )
+                        p_root->steps[s] = (unsigned short)(p_remap[target_old] - n);
+                }
+                break;
+            }
+            default : break;
+        }
+    }
+
+    p_factory->count = w;
+
+    __fuse_bail:
+        free( p_is_target );
+        free( p_remap );
+        free( p_old_of );
+}
+
+
+
+// Compress the contents of a staged block sequence into a single calloc and set it in
+//   the factory. This is a trivial shrink-to-fit: each staged block is copied by value
+//   into one linear array and the staging shells are released.
+// Upper bound on a factory's baked constant-prefix buffer. The bake stops growing
+//   at this size and generation falls back to the interpreter for the remainder.
+#define FUZZ_CONST_PREFIX_LIMIT (1UL << 16)
+
+// Return one past the end of the top-level program unit starting at 'i': a lone
+//   block is itself, while a 'sub' runs through its matching 'ret'. Returns 0 when
+//   the sub never closes (malformed program).
+static size_t __bake_unit_end( fuzz_pattern_block_t* p_blocks, size_t count, size_t i ) {
+    if ( sub != p_blocks[i].type )  return (i + 1);
+
+    size_t depth = 1;
+    size_t r = (i + 1);
+
+    for ( ; r < count && depth > 0; r++ ) {
+        if ( sub == p_blocks[r].type )  depth++;
+        else if ( ret == p_blocks[r].type )  depth--;
+    }
+
+    return ( depth > 0 ) ? 0 : r;
+}
 
-    // Fetch the list items count, calloc, set each cell, and create the factory.
-    //   This is also partially local variable declaration space.
-    size_t len = List__length( p_list );
+// Emit the blocks of a fully deterministic [from, to) range into the bake buffer.
+//   Only fixed-count strings and fixed-count subs (recursively) qualify; any other
+//   block type -- or busting the bake budget -- fails the whole range. Returns
+//   non-zero on success.
+static int __bake_emit_range(
+    fuzz_pattern_block_t* p_blocks,
+    size_t from,
+    size_t to,
+    unsigned char* p_out,
+    size_t* p_len
+) {
+    for ( size_t i = from; i < to; i++ ) {
+        fuzz_pattern_block_t* p_block = &(p_blocks[i]);
+
+        if (  string == p_block->type && (p_block->count).single  ) {
+            size_t unit = p_block->operand.str.length;
+
+            if (  (*p_len + (unit * (p_block->count).base)) > FUZZ_CONST_PREFIX_LIMIT  )
+                return 0;
+
+            for ( unsigned short r = 0; r < (p_block->count).base; r++ ) {
+                memcpy( (p_out + *p_len), p_block->operand.str.p_str, unit );
+                *p_len += unit;
+            }
+
+            continue;
+        }
+
+        if (  sub == p_block->type && (p_block->count).single  ) {
+            size_t unit_end = __bake_unit_end( p_blocks, to, i );
+            if ( 0 == unit_end )  return 0;
+
+            // The body runs once per fixed iteration; 'ret' itself emits nothing.
+            for ( unsigned short c = 0; c < (p_block->count).base; c++ ) {
+                if (  !__bake_emit_range( p_blocks, (i + 1), (unit_end - 1), p_out, p_len )  )
+                    return 0;
+            }
+
+            i = (unit_end - 1);   //land on the 'ret'; the loop increment moves beyond it
+            continue;
+        }
+
+        return 0;   //anything else is (or may be) variable
+    }
+
+    return 1;
+}
+
+// Compiler analysis pass over a finished program: bake the maximal constant
+//   prefix -- the run of fixed-count strings and fully deterministic fixed-count
+//   subsequences at the front -- into a flat buffer the generator lands with a
+//   single copy, entering the interpreter at the first variable block. Factories
+//   whose ENTIRE program is deterministic are flagged so generation degenerates
+//   to just that copy. Baked blocks no longer tick per-block execution counters;
+//   they cost nothing, which is the point.
+static void __bake_constant_prefix( fuzz_factory_t* p_ff ) {
+    fuzz_pattern_block_t* p_blocks = (fuzz_pattern_block_t*)(p_ff->node_seq);
+
+    unsigned char* p_bake = (unsigned char*)malloc( FUZZ_CONST_PREFIX_LIMIT );
+    if ( NULL == p_bake )  return;
+
+    size_t len = 0;
+    size_t i = 0;
+
+    while ( i < p_ff->count ) {
+        fuzz_pattern_block_t* p_block = &(p_blocks[i]);
+
+        if ( end == p_block->type ) {
+            // Every block baked: the whole output is the constant prefix.
+            p_ff->is_constant = 1;
+            break;
+        }
+
+        if (  ( string == p_block->type || sub == p_block->type ) && (p_block->count).single  ) {
+            size_t unit_end = __bake_unit_end( p_blocks, p_ff->count, i );
+            size_t undo = len;
+
+            if (  unit_end > 0 && __bake_emit_range( p_blocks, i, unit_end, p_bake, &len )  ) {
+                i = unit_end;
+                continue;
+            }
+
+            // Partially-emitted unit (variable innards or over budget): roll it
+            //   back whole so the interpreter replays it from a clean boundary.
+            len = undo;
+        }
+
+        break;   //first variable block: the interpreter resumes here
+    }
+
+    if ( 0 == len ) {
+        free( p_bake );
+        return;
+    }
+
+    // Shrink to fit; on the (unlikely) realloc failure just keep the full buffer.
+    unsigned char* p_fit = (unsigned char*)realloc( p_bake, len );
+    p_ff->p_const_prefix = ( NULL != p_fit ) ? p_fit : p_bake;
+    p_ff->const_prefix_len = len;
+    p_ff->const_resume_index = i;
+}
+
+
+
+static fuzz_factory_t* __compress_List_to_factory( fuzz_block_seq_t* p_seq ) {
+    if ( NULL == p_seq )  return NULL;
+
+    size_t len = p_seq->count;
 
     fuzz_factory_t* x = (fuzz_factory_t*)calloc( 1, sizeof(fuzz_factory_t) );
     x->count = (len + 1);   // +1 for 'end' node
@@ -145,11 +563,15 @@ static fuzz_factory_t* __compress_List_to_factory( List_t* p_list ) {
     if ( len < 1 )
         goto __compress_err;
 
-    // Convert the linked list of Blocks into a linear array in memory.
-    p_data = List__to_array( p_list, sizeof(fuzz_pattern_block_t), sizeof(fuzz_pattern_block_t) );
+    // Copy the staged Blocks into a linear array in memory.
+    p_data = calloc( (len + 1), sizeof(fuzz_pattern_block_t) );
     if ( NULL == p_data )
         goto __compress_err;
 
+    for ( size_t i = 0; i < len; i++ )
+        memcpy( (p_data + (i * sizeof(fuzz_pattern_block_t))),
+            *((p_seq->pp_blocks)+i), sizeof(fuzz_pattern_block_t) );
+
     // Set the node sequence pointer to the linear array, and the max output size.
     x->node_seq = p_data;
     x->max_output_size = 0;
@@ -159,16 +581,26 @@ static fuzz_factory_t* __compress_List_to_factory( List_t* p_list ) {
     fuzz_pattern_block_t* p_end =
         (fuzz_pattern_block_t*)(p_data + (len * sizeof(fuzz_pattern_block_t)));
     p_end->type = end;
-    p_end->data = NULL;   // count and label don't matter, just the 'end' type
+    p_end->operand.raw = NULL;   // count and label don't matter, just the 'end' type
+
+    // Run the string-fusion peephole over the finished sequence, then bake
+    //   whatever deterministic front the fused program exposes.
+    __fuse_adjacent_strings( x );
+    __bake_constant_prefix( x );
+
+    // The operands now belong to the factory's linear program; only the staging
+    //   shells and the sequence container get released here.
+    for ( size_t i = 0; i < len; i++ )
+        free( *((p_seq->pp_blocks)+i) );
+    __blockseq_delete_shallow( p_seq );
 
     // Return the built factory.
-    List__delete_deep( &p_list );
     return x;
 
     __compress_err:
         free( x );
         free( p_data );
-        List__delete_deep( &p_list );
+        __blockseq_delete_deep( p_seq );
         return NULL;
 }
 
@@ -218,7 +650,7 @@ static inline size_t __PatternFactory__get_max_output_size( fuzz_factory_t* p_ff
                 break;
             }
             case reference : {
-                fuzz_reference_t* p_x = (fuzz_reference_t*)(p_block->data);
+                fuzz_reference_t* p_x = p_block->operand.p_ref;
                 if ( ref_declaration == p_x->type || ref_shuffle == p_x->type )
                     break;
 
@@ -234,7 +666,7 @@ static inline size_t __PatternFactory__get_max_output_size( fuzz_factory_t* p_ff
                 if ( NULL == p_subctx )
                     goto __max_output_next_block;
 
-                fuzz_factory_t* p_factory = ((fuzz_gen_ctx_t*)(p_subctx->p_gen_ctx))->p_factory;
+                fuzz_factory_t* p_factory = p_subctx->p_factory;
 
                 possible_generation_size += (total_multiplier * p_factory->max_output_size * (p_block->count).high);
             }
@@ -244,7 +676,7 @@ static inline size_t __PatternFactory__get_max_output_size( fuzz_factory_t* p_ff
                 //   Ex: (abc(de{1,5}f){,3}){4,5} --> 'e' will count 75 (5x3x5) possible times.
                 size_t data_len = 1;
                 if ( string == p_block->type )
-                    data_len = strlen( (char*)(p_block->data) );
+                    data_len = p_block->operand.str.length;
                 possible_generation_size += (total_multiplier * data_len * (p_block->count).high);
                 break;
             }
@@ -274,41 +706,68 @@ static inline size_t __PatternFactory__get_max_output_size( fuzz_factory_t* p_ff
 
 
 
+// Free whatever heap memory a block's inline operand points to, if any. Blocks whose
+//   operand is stored by value (sub/ret/branch_jmp steps, 'end') own nothing.
+static void __pattern_block_free_operand( fuzz_pattern_block_t* p_block ) {
+    if ( NULL == p_block )  return;
+
+    switch ( p_block->type ) {
+        case string      :
+        case range       :
+        case reference   :
+        case branch_root : {
+            if ( NULL != p_block->operand.raw )
+                free( p_block->operand.raw );
+            break;
+        }
+        default : break;   // inline operands: nothing on the heap
+    }
+
+    p_block->operand.raw = NULL;
+}
+
+
+
 // Frees space used by a pattern factory by destroying it and its nodes' datas from the heap.
 void PatternFactory__delete( fuzz_factory_t* p_fact ) {
     if ( NULL == p_fact )  return;
 
-    // We assume that any nodes/blocks in the node sequence have free-able memory in their
-    //   data voidptr, so long as the value != null (such as 'end' blocks).
-    fuzz_pattern_block_t* p_base_block = (fuzz_pattern_block_t*)(p_fact->node_seq);
+    // Free any heap-resident operands in the node sequence; inline operands are
+    //   released along with the blob itself below. Mapped factories skip this:
+    //   their operands live inside the compiled-file mapping, not the heap.
+    if ( !p_fact->is_mapped ) {
+        fuzz_pattern_block_t* p_base_block = (fuzz_pattern_block_t*)(p_fact->node_seq);
 
-    for ( size_t i = 0; i < p_fact->count; i++ ) {
-        fuzz_pattern_block_t* x = (p_base_block + i);
-
-        if ( NULL != x && NULL != x->data ) {
-            free( x->data );
-            x->data = NULL;
-        }
+        for ( size_t i = 0; i < p_fact->count; i++ )
+            __pattern_block_free_operand( p_base_block + i );
     }
 
-    // Delete all subcontexts.
+    // Delete all attached sub-factories. Per-run subcontext state (generator
+    //   contexts and scratch slabs) belongs to generator contexts, not here.
+    //   Interned slots only borrow their canonical slot's factory; skip those.
     if ( p_fact->subcontexts_count > 0 ) {
         for ( size_t i = 0; i < p_fact->subcontexts_count; i++ ) {
-            Generator__delete_context(  (p_fact->subcontexts[i]).p_gen_ctx  );
-            (p_fact->subcontexts[i]).p_gen_ctx = NULL;
-
-            if ( NULL != (p_fact->subcontexts[i]).p_most_recent ) {
-                free( (void*)(((fuzz_str_t*)(p_fact->subcontexts[i]).p_most_recent)->output) );
-                free( (void*)(p_fact->subcontexts[i]).p_most_recent );
-                (p_fact->subcontexts[i]).p_most_recent = NULL;
-            }
+            if ( i == (p_fact->subcontexts[i]).intern_of )
+                PatternFactory__delete(  (p_fact->subcontexts[i]).p_factory  );
+            (p_fact->subcontexts[i]).p_factory = NULL;
         }
     }
 
-    // Free the pattern_block blob.
-    if ( NULL != p_fact->node_seq ) {
+    // Free the pattern_block blob, or drop the file mapping for loaded factories
+    //   (only the root of a loaded tree carries the mapping handle).
+    if ( !p_fact->is_mapped && NULL != p_fact->node_seq )
         free( p_fact->node_seq );
-        p_fact->node_seq = NULL;
+    p_fact->node_seq = NULL;
+
+    if ( NULL != p_fact->p_map_base ) {
+        munmap( p_fact->p_map_base, p_fact->map_size );
+        p_fact->p_map_base = NULL;
+    }
+
+    // The baked prefix is heap-owned even when the factory itself is mapped.
+    if ( NULL != p_fact->p_const_prefix ) {
+        free( p_fact->p_const_prefix );
+        p_fact->p_const_prefix = NULL;
     }
 
     // And free the factory itself.
@@ -317,6 +776,144 @@ void PatternFactory__delete( fuzz_factory_t* p_fact ) {
 
 
 
+// Fold a raw byte span into a running djb2 hash.
+static inline unsigned long __structural_hash_bytes(
+    unsigned long hash, const void* p_bytes, size_t length
+) {
+    const unsigned char* p = (const unsigned char*)p_bytes;
+    for ( size_t i = 0; i < length; i++ )
+        hash = ((hash << 5) + hash) + *(p+i);
+    return hash;
+}
+
+// Structural (djb2) hash of a compiled factory: folds in every block's type, counts,
+//   and operand PAYLOAD (not its address), recursing through attached sub-factories.
+//   Two factories compiled from identical fragments hash identically, letting the
+//   interning scan below short-circuit most non-matches before the deep comparison.
+static unsigned long __factory_structural_hash( fuzz_factory_t* p_fact ) {
+    unsigned long hash = 5381;
+    if ( NULL == p_fact )  return hash;
+
+    fuzz_pattern_block_t* p_blocks = (fuzz_pattern_block_t*)(p_fact->node_seq);
+
+    for ( size_t i = 0; i < p_fact->count; i++ ) {
+        hash = __structural_hash_bytes( hash, &(p_blocks[i].type), sizeof(pattern_block_type) );
+        hash = __structural_hash_bytes( hash, &(p_blocks[i].count), sizeof(fuzz_repetition_t) );
+
+        switch ( p_blocks[i].type ) {
+            case string : {
+                hash = __structural_hash_bytes( hash,
+                    p_blocks[i].operand.str.p_str, p_blocks[i].operand.str.length );
+                break;
+            }
+            case range : {
+                hash = __structural_hash_bytes( hash,
+                    p_blocks[i].operand.p_range, sizeof(fuzz_range_t) );
+                break;
+            }
+            case reference : {
+                hash = __structural_hash_bytes( hash,
+                    p_blocks[i].operand.p_ref, sizeof(fuzz_reference_t) );
+                break;
+            }
+            case branch_root : {
+                hash = __structural_hash_bytes( hash,
+                    p_blocks[i].operand.p_branch, sizeof(fuzz_branch_root_t) );
+                break;
+            }
+            default : {
+                // Inline operands (sub/ret/branch_jmp steps; 'end' carries nothing).
+                hash = __structural_hash_bytes( hash,
+                    &(p_blocks[i].operand.step), sizeof(size_t) );
+                break;
+            }
+        }
+    }
+
+    for ( size_t s = 0; s < p_fact->subcontexts_count; s++ ) {
+        hash = __structural_hash_bytes( hash,
+            &((p_fact->subcontexts[s]).label[0]), FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH );
+        hash ^= __factory_structural_hash( (p_fact->subcontexts[s]).p_factory );
+    }
+
+    return hash;
+}
+
+// Deep structural comparison of two compiled factories: equal iff they would
+//   generate identical output distributions through the same instruction walk.
+//   Operand structs are calloc'd at parse time, so padding is zero and memcmp
+//   over whole payloads is exact.
+static int __factory_structurally_equal( fuzz_factory_t* p_a, fuzz_factory_t* p_b ) {
+    if ( p_a == p_b )  return 1;
+    if ( NULL == p_a || NULL == p_b )  return 0;
+
+    if (
+           p_a->count != p_b->count
+        || p_a->max_output_size != p_b->max_output_size
+        || p_a->subcontexts_count != p_b->subcontexts_count
+    )  return 0;
+
+    fuzz_pattern_block_t* p_blocks_a = (fuzz_pattern_block_t*)(p_a->node_seq);
+    fuzz_pattern_block_t* p_blocks_b = (fuzz_pattern_block_t*)(p_b->node_seq);
+
+    for ( size_t i = 0; i < p_a->count; i++ ) {
+        if (
+               p_blocks_a[i].type != p_blocks_b[i].type
+            || 0 != memcmp( &(p_blocks_a[i].count), &(p_blocks_b[i].count),
+                   sizeof(fuzz_repetition_t) )
+        )  return 0;
+
+        switch ( p_blocks_a[i].type ) {
+            case string : {
+                if (
+                       p_blocks_a[i].operand.str.length != p_blocks_b[i].operand.str.length
+                    || 0 != memcmp( p_blocks_a[i].operand.str.p_str,
+                           p_blocks_b[i].operand.str.p_str, p_blocks_a[i].operand.str.length )
+                )  return 0;
+                break;
+            }
+            case range : {
+                if (  0 != memcmp( p_blocks_a[i].operand.p_range,
+                        p_blocks_b[i].operand.p_range, sizeof(fuzz_range_t) )  )
+                    return 0;
+                break;
+            }
+            case reference : {
+                if (  0 != memcmp( p_blocks_a[i].operand.p_ref,
+                        p_blocks_b[i].operand.p_ref, sizeof(fuzz_reference_t) )  )
+                    return 0;
+                break;
+            }
+            case branch_root : {
+                if (  0 != memcmp( p_blocks_a[i].operand.p_branch,
+                        p_blocks_b[i].operand.p_branch, sizeof(fuzz_branch_root_t) )  )
+                    return 0;
+                break;
+            }
+            default : {
+                if ( p_blocks_a[i].operand.step != p_blocks_b[i].operand.step )
+                    return 0;
+                break;
+            }
+        }
+    }
+
+    for ( size_t s = 0; s < p_a->subcontexts_count; s++ ) {
+        if (
+               (p_a->subcontexts[s]).hash != (p_b->subcontexts[s]).hash
+            || (p_a->subcontexts[s]).intern_of != (p_b->subcontexts[s]).intern_of
+            || 0 != memcmp( &((p_a->subcontexts[s]).label[0]),
+                   &((p_b->subcontexts[s]).label[0]), FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH )
+            || !__factory_structurally_equal(
+                   (p_a->subcontexts[s]).p_factory, (p_b->subcontexts[s]).p_factory )
+        )  return 0;
+    }
+
+    return 1;
+}
+
+
+
 // Explain step-by-step what the fuzz factory is doing to generate data through the given factory.
 void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
     if ( NULL == p_fact ) {
@@ -330,8 +927,7 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
             p_fact->subcontexts_count  );
 
         for ( size_t i = 0; i < p_fact->subcontexts_count; i++ ) {
-            fuzz_factory_t* p_subfact =
-                Generator__get_context_factory(  (p_fact->subcontexts[i]).p_gen_ctx  );
+            fuzz_factory_t* p_subfact = (p_fact->subcontexts[i]).p_factory;
 
             fprintf(  fp_stream, "\n===> Sub-factory '%s':\n",
                 (p_fact->subcontexts[i]).label  );
@@ -343,6 +939,14 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
         fprintf( fp_stream, "********** Parent Factory **********\n" );
     }
 
+    // Surface the compiler's constant-prefix analysis before walking the blocks.
+    if ( p_fact->is_constant )
+        fprintf(  fp_stream, "[Constant] Every output is the same %lu pre-rendered bytes.\n",
+            p_fact->const_prefix_len  );
+    else if ( p_fact->const_prefix_len > 0 )
+        fprintf(  fp_stream, "[Baked] %lu-byte constant prefix; generation resumes at block %lu.\n",
+            p_fact->const_prefix_len, p_fact->const_resume_index  );
+
     size_t nest = 0;
 
     // Iterate the factory nodes and explain each.
@@ -386,7 +990,7 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
                 //         create pattern blocks to use and this is an explanation thereof.
                 const char* p_reftype;
                 char* p_pre_reftype = NULL;
-                fuzz_reference_t* p_ref = (fuzz_reference_t*)(p->data);
+                fuzz_reference_t* p_ref = p->operand.p_ref;
 
                 switch ( p_ref->type ) {
                     case ref_reference      : {  p_reftype = "Paste pre-generated"; break;  }
@@ -419,14 +1023,14 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
 
             case string: {
                 fprintf( fp_stream, "Output static string: '%s' (%s times)\n",
-                    (const char*)(p->data), p_range_str );
+                    p->operand.str.p_str, p_range_str );
 
                 break;
             }
 
             case range: {
                 // Ranges have a touch of complexity about them to explain since they're dynamic mechanisms.
-                fuzz_range_t* p_range = (fuzz_range_t*)(p->data);
+                fuzz_range_t* p_range = p->operand.p_range;
                 if ( !p_range || !(p_range->amount) ) {
                     fprintf( fp_stream, "~~~~~ Misunderstood or empty range. Problem!\n" );
                     break;
@@ -451,14 +1055,14 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
 
             case sub: {
                 fprintf( fp_stream, "vvv  Enter subsequence layer (nest tag %lu), which runs '%s' times.\n",
-                    *((size_t*)(p->data)), p_range_str );
+                    p->operand.step, p_range_str );
 
                 nest++;
                 break;
             }
             case ret: {
                 fprintf( fp_stream, "^^^  Repeat subsequence layer as applicable; goes '%lu' nodes back.\n",
-                    *((size_t*)(p->data)) );
+                    p->operand.step );
 
                 nest--;
                 break;
@@ -466,7 +1070,7 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
 
             case branch_root: {
                 // Get the different step-count possibilities.
-                fuzz_branch_root_t* p_step = (fuzz_branch_root_t*)(p->data);
+                fuzz_branch_root_t* p_step = p->operand.p_branch;
                 size_t amount = p_step->amount;
 
                 // This should never happen -- there are always at least two conditions in an OR.
@@ -482,7 +1086,26 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
                 sprintf( (p_steps+strlen(p_steps)), "or %hu", p_step->steps[amount] );
                 *(p_steps+len-1) = '\0';   //paranoia
 
-                fprintf( fp_stream, "[BRANCH] Leap forward '%s' steps.\n", p_steps );
+                if ( p_step->weighted ) {
+                    // Mirror the steps list with the raw per-alternative weights.
+                    size_t wlen = ((FUZZ_MAX_STEPS-1)*7)+8+1;
+                    char* p_weights = (char*)calloc( wlen, sizeof(char) );
+
+                    for ( size_t x = 0; x < amount; x++ )
+                        sprintf( (p_weights+strnlen(p_weights,wlen-8)), "%hu, ",
+                            (unsigned short)(p_step->weights[x] ? p_step->weights[x] : 1) );
+
+                    sprintf( (p_weights+strlen(p_weights)), "or %hu",
+                        (unsigned short)(p_step->weights[amount] ? p_step->weights[amount] : 1) );
+                    *(p_weights+wlen-1) = '\0';   //paranoia
+
+                    fprintf( fp_stream, "[BRANCH] Leap forward '%s' steps, weighted '%s' respectively.\n",
+                        p_steps, p_weights );
+
+                    free( p_weights );
+                } else {
+                    fprintf( fp_stream, "[BRANCH] Leap forward '%s' steps.\n", p_steps );
+                }
 
                 free( p_steps );
                 break;
@@ -490,7 +1113,7 @@ void PatternFactory__explain( FILE* fp_stream, fuzz_factory_t* p_fact ) {
             case branch_jmp: {
                 // Jump label.
                 fprintf( fp_stream, "[BRANCH-END] Jump '%lu' steps ahead to exit branch.\n",
-                    *((size_t*)(p->data)) );
+                    p->operand.step );
 
                 break;
             }
@@ -528,7 +1151,7 @@ fuzz_factory_t* PatternFactory__new( const char* p_pattern_str, fuzz_error_t** p
 
 
     // Parse the pattern and manufacture the factory. MAGIC!
-    List_t* p_the_sequence = __parse_pattern( p_ctx, p_pattern_str );
+    fuzz_block_seq_t* p_the_sequence = __parse_pattern( p_ctx, p_pattern_str );
 
     fuzz_factory_t* p_ff = __compress_List_to_factory( p_the_sequence );
     if ( NULL == p_ff ) {
@@ -544,6 +1167,24 @@ fuzz_factory_t* PatternFactory__new( const char* p_pattern_str, fuzz_error_t** p
     p_ff->subcontexts_count = p_ctx->subcontexts_count;
     p_ctx->subcontexts_count = 0;
 
+    // Resolve every reference block to its subcontext slot now that all declarations
+    //   are attached. Generation then costs a single array index per reference; an
+    //   undeclared label keeps the sentinel and faults that run like before.
+    fuzz_pattern_block_t* p_blocks = (fuzz_pattern_block_t*)(p_ff->node_seq);
+    for ( size_t i = 0; i < p_ff->count; i++ ) {
+        if ( reference != p_blocks[i].type )  continue;
+
+        fuzz_reference_t* p_ref = p_blocks[i].operand.p_ref;
+        p_ref->subctx_index = FUZZ_MAX_SUBCONTEXTS;
+
+        for ( size_t s = 0; s < p_ff->subcontexts_count; s++ ) {
+            if (  0 == strcmp( &((p_ff->subcontexts[s]).label[0]), &(p_ref->label[0]) )  ) {
+                p_ref->subctx_index = s;
+                break;
+            }
+        }
+    }
+
     // Get the max possible output size of the factory.
     size_t max_size = __PatternFactory__get_max_output_size( p_ff );
     if ( !max_size ) {
@@ -577,6 +1218,516 @@ fuzz_subcontext_t* PatternFactory__get_subcontext( fuzz_factory_t* p_factory, ch
 
 
 
+////////////////////////////////////////////////////////////////////////////////////
+// Compiled-factory file format (version 1).
+//
+// The file is a flat, relocatable image of the factory tree: every pointer operand
+//   in the node sequence is stored as a file-relative offset, so loading is a
+//   private mmap plus one in-place (copy-on-write) fixup pass over the nodes. The
+//   structs below are raw in-memory layouts, so the header records their sizes as
+//   an ABI fingerprint: a compiled file only loads on a matching build.
+
+#define FUZZ_COMPILED_MAGIC \
+    (  (uint32_t)'N' | ((uint32_t)'F' << 8) | ((uint32_t)'Z' << 16) | ((uint32_t)'C' << 24)  )
+#define FUZZ_COMPILED_VERSION 3
+
+// Keep every section 16-byte aligned within the file (the mapping itself is page-aligned).
+#define __COMPILED_ALIGN(x) ( ((x) + 15) & ~((size_t)15) )
+
+// On-disk file header.
+typedef struct _fuzz_compiled_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t block_size;    // sizeof(fuzz_pattern_block_t) of the writing build
+    uint64_t file_size;
+    uint64_t root_offset;   // file-relative offset of the root factory record
+} fuzz_compiled_header_t;
+
+// One serialized factory. All offsets are file-relative.
+typedef struct _fuzz_compiled_factory_t {
+    uint64_t count;
+    uint64_t max_output_size;
+    uint64_t subcontexts_count;
+    uint64_t nodes_offset;   // the node blob (count * sizeof(fuzz_pattern_block_t))
+    uint64_t subs_offset;    // the subcontext entry table
+} fuzz_compiled_factory_t;
+
+// One serialized subcontext table entry. Interned entries point their
+//   factory_offset at the canonical slot's record, which is written only once.
+typedef struct _fuzz_compiled_sub_t {
+    uint64_t hash;
+    uint64_t factory_offset;   // nested fuzz_compiled_factory_t record
+    uint64_t intern_of;        // canonical slot index (== own index when canonical)
+    char label[FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH];
+    char _pad[16 - (FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH % 16)];
+} fuzz_compiled_sub_t;
+
+
+// Compute the serialized size of a factory tree, aligned section by section.
+static size_t __factory_compiled_size( fuzz_factory_t* p_fact ) {
+    size_t total = __COMPILED_ALIGN( sizeof(fuzz_compiled_factory_t) );
+    total += __COMPILED_ALIGN( p_fact->count * sizeof(fuzz_pattern_block_t) );
+
+    fuzz_pattern_block_t* p_blocks = (fuzz_pattern_block_t*)(p_fact->node_seq);
+    for ( size_t i = 0; i < p_fact->count; i++ ) {
+        switch ( p_blocks[i].type ) {
+            case string      : {  total += __COMPILED_ALIGN( p_blocks[i].operand.str.length + 1 );  break;  }
+            case range       : {  total += __COMPILED_ALIGN( sizeof(fuzz_range_t) );  break;  }
+            case reference   : {  total += __COMPILED_ALIGN( sizeof(fuzz_reference_t) );  break;  }
+            case branch_root : {  total += __COMPILED_ALIGN( sizeof(fuzz_branch_root_t) );  break;  }
+            default          : break;   // inline operands travel inside the node blob
+        }
+    }
+
+    total += __COMPILED_ALIGN( p_fact->subcontexts_count * sizeof(fuzz_compiled_sub_t) );
+
+    // Interned slots reuse their canonical slot's record; only canonical
+    //   sub-factories occupy space in the image.
+    for ( size_t s = 0; s < p_fact->subcontexts_count; s++ ) {
+        if ( s == (p_fact->subcontexts[s]).intern_of )
+            total += __factory_compiled_size( (p_fact->subcontexts[s]).p_factory );
+    }
+
+    return total;
+}
+
+
+// Write a factory record (and, recursively, its sub-factories) into the image at
+//   the running cursor. Pointer operands in the copied node blob are replaced by
+//   file-relative offsets. Returns the record's own offset.
+static uint64_t __factory_compiled_write(
+    fuzz_factory_t* p_fact, unsigned char* p_buf, size_t* p_cursor
+) {
+    size_t base = *p_cursor;
+    fuzz_compiled_factory_t* p_rec = (fuzz_compiled_factory_t*)(p_buf + base);
+    *p_cursor += __COMPILED_ALIGN( sizeof(fuzz_compiled_factory_t) );
+
+    p_rec->count = p_fact->count;
+    p_rec->max_output_size = p_fact->max_output_size;
+    p_rec->subcontexts_count = p_fact->subcontexts_count;
+
+    // Copy the node blob wholesale; inline operands (steps, cached lengths) are
+    //   position-independent already and survive the memcpy untouched.
+    p_rec->nodes_offset = *p_cursor;
+    memcpy( (p_buf + p_rec->nodes_offset), p_fact->node_seq,
+        (p_fact->count * sizeof(fuzz_pattern_block_t)) );
+    *p_cursor += __COMPILED_ALIGN( p_fact->count * sizeof(fuzz_pattern_block_t) );
+
+    // Append each heap operand's payload and swap the copied node's pointer for
+    //   the payload's file-relative offset.
+    fuzz_pattern_block_t* p_src = (fuzz_pattern_block_t*)(p_fact->node_seq);
+    fuzz_pattern_block_t* p_out = (fuzz_pattern_block_t*)(p_buf + p_rec->nodes_offset);
+
+    for ( size_t i = 0; i < p_fact->count; i++ ) {
+        size_t off = *p_cursor;
+
+        switch ( p_src[i].type ) {
+            case string : {
+                size_t len = p_src[i].operand.str.length;
+                memcpy( (p_buf + off), p_src[i].operand.str.p_str, len );
+                *(p_buf + off + len) = '\0';
+                p_out[i].operand.str.p_str = (char*)(uintptr_t)off;
+                *p_cursor += __COMPILED_ALIGN( len + 1 );
+                break;
+            }
+            case range : {
+                memcpy( (p_buf + off), p_src[i].operand.p_range, sizeof(fuzz_range_t) );
+                p_out[i].operand.raw = (void*)(uintptr_t)off;
+                *p_cursor += __COMPILED_ALIGN( sizeof(fuzz_range_t) );
+                break;
+            }
+            case reference : {
+                memcpy( (p_buf + off), p_src[i].operand.p_ref, sizeof(fuzz_reference_t) );
+                p_out[i].operand.raw = (void*)(uintptr_t)off;
+                *p_cursor += __COMPILED_ALIGN( sizeof(fuzz_reference_t) );
+                break;
+            }
+            case branch_root : {
+                memcpy( (p_buf + off), p_src[i].operand.p_branch, sizeof(fuzz_branch_root_t) );
+                p_out[i].operand.raw = (void*)(uintptr_t)off;
+                *p_cursor += __COMPILED_ALIGN( sizeof(fuzz_branch_root_t) );
+                break;
+            }
+            default : break;
+        }
+    }
+
+    // The subcontext table, then each nested sub-factory record behind it.
+    p_rec->subs_offset = *p_cursor;
+    fuzz_compiled_sub_t* p_subs = (fuzz_compiled_sub_t*)(p_buf + p_rec->subs_offset);
+    *p_cursor += __COMPILED_ALIGN( p_fact->subcontexts_count * sizeof(fuzz_compiled_sub_t) );
+
+    for ( size_t s = 0; s < p_fact->subcontexts_count; s++ ) {
+        size_t canon = (p_fact->subcontexts[s]).intern_of;
+
+        p_subs[s].hash = (p_fact->subcontexts[s]).hash;
+        p_subs[s].intern_of = (uint64_t)canon;
+        memcpy(  &(p_subs[s].label[0]), &((p_fact->subcontexts[s]).label[0]),
+            FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH  );
+
+        // Canonical factories are written exactly once; interned entries simply
+        //   point back at the canonical slot's already-recorded offset.
+        p_subs[s].factory_offset = ( canon == s )
+            ? __factory_compiled_write( (p_fact->subcontexts[s]).p_factory, p_buf, p_cursor )
+            : p_subs[canon].factory_offset
+        ;
+    }
+
+    return (uint64_t)base;
+}
+
+
+// Serialize a compiled factory tree into a versioned file. Returns non-zero on success.
+int PatternFactory__save( fuzz_factory_t* p_fact, const char* p_path ) {
+    if ( NULL == p_fact || NULL == p_path )  return 0;
+
+    size_t total = __COMPILED_ALIGN( sizeof(fuzz_compiled_header_t) )
+        + __factory_compiled_size( p_fact );
+
+    unsigned char* p_buf = (unsigned char*)calloc( 1, total );
+    if ( NULL == p_buf )  return 0;
+
+    size_t cursor = __COMPILED_ALIGN( sizeof(fuzz_compiled_header_t) );
+    uint64_t root_offset = __factory_compiled_write( p_fact, p_buf, &cursor );
+
+    fuzz_compiled_header_t* p_hdr = (fuzz_compiled_header_t*)p_buf;
+    p_hdr->magic = FUZZ_COMPILED_MAGIC;
+    p_hdr->version = FUZZ_COMPILED_VERSION;
+    p_hdr->block_size = (uint16_t)sizeof(fuzz_pattern_block_t);
+    p_hdr->file_size = cursor;
+    p_hdr->root_offset = root_offset;
+
+    FILE* fp_out = fopen( p_path, "wb" );
+    if ( NULL == fp_out ) {
+        free( p_buf );
+        return 0;
+    }
+
+    size_t written = fwrite( p_buf, sizeof(unsigned char), cursor, fp_out );
+
+    fclose( fp_out );
+    free( p_buf );
+
+    return ( written == cursor );
+}
+
+
+// Rebuild one factory from its record inside the mapping, fixing pointer operands
+//   up in place. Every offset is bounds-checked against the mapping before use so
+//   a truncated or corrupted file cannot walk the loader out of the image.
+static fuzz_factory_t* __factory_load_at(
+    unsigned char* p_base, size_t map_size, uint64_t offset, size_t depth
+) {
+    // A sub record pointing back at an ancestor would recurse forever; no honest
+    //   tree of subcontext declarations nests deeper than the table is wide.
+    if ( depth > FUZZ_MAX_SUBCONTEXTS )  return NULL;
+
+    // All offset checks use the overflow-safe form: a file-controlled offset near
+    //   UINT64_MAX must not wrap the addition past the bound.
+    if (  offset > map_size || sizeof(fuzz_compiled_factory_t) > (map_size - offset)  )
+        return NULL;
+    fuzz_compiled_factory_t* p_rec = (fuzz_compiled_factory_t*)(p_base + offset);
+
+    if (
+           p_rec->subcontexts_count > FUZZ_MAX_SUBCONTEXTS
+        || p_rec->count > (map_size / sizeof(fuzz_pattern_block_t))
+        || p_rec->nodes_offset > map_size
+        || (p_rec->count * sizeof(fuzz_pattern_block_t)) > (map_size - p_rec->nodes_offset)
+        // The compiler never emits a factory outside these output bounds, so a
+        //   record outside them is corruption; this also stops generator contexts
+        //   from sizing their pools off a wild value.
+        || p_rec->max_output_size < 1
+        || p_rec->max_output_size > FUZZ_MAX_OUTPUT_SIZE
+    )  return NULL;
+
+    fuzz_factory_t* p_fact = (fuzz_factory_t*)calloc( 1, sizeof(fuzz_factory_t) );
+    if ( NULL == p_fact )  return NULL;
+
+    p_fact->is_mapped = 1;
+    p_fact->count = p_rec->count;
+    p_fact->max_output_size = p_rec->max_output_size;
+    p_fact->node_seq = (void*)(p_base + p_rec->nodes_offset);
+
+    // Fix up the pointer operands; the mapping is private, so these writes only
+    //   dirty this process's copy-on-write pages.
+    fuzz_pattern_block_t* p_blocks = (fuzz_pattern_block_t*)(p_fact->node_seq);
+
+    for ( size_t i = 0; i < p_fact->count; i++ ) {
+        size_t payload = 0;
+
+        switch ( p_blocks[i].type ) {
+            case string      : {
+                // A corrupted SIZE_MAX length must not wrap 'payload' to zero and
+                //   slip past the bounds check below; anything at or beyond the
+                //   mapping size cannot be a real payload anyway.
+                if ( p_blocks[i].operand.str.length >= map_size )
+                    goto __load_fault;
+                payload = (p_blocks[i].operand.str.length + 1);
+                break;
+            }
+            case range       : {  payload = sizeof(fuzz_range_t);  break;  }
+            case reference   : {  payload = sizeof(fuzz_reference_t);  break;  }
+            case branch_root : {  payload = sizeof(fuzz_branch_root_t);  break;  }
+
+            case ret         : {
+                // Inline operand: 'step' walks BACKWARD to its matching sub, so it
+                //   must stay inside the program's front.
+                if (  p_blocks[i].operand.step < 1 || p_blocks[i].operand.step > i  )
+                    goto __load_fault;
+                continue;
+            }
+            case branch_jmp  : {
+                // Inline operand: 'step' must land on a LATER block of this program.
+                if (  p_blocks[i].operand.step < 1
+                    || (i + p_blocks[i].operand.step) >= p_rec->count  )
+                    goto __load_fault;
+                continue;
+            }
+
+            case sub         :
+            case end         : {  continue;  }   // inline operand; nothing to relocate
+
+            default          : {  goto __load_fault;  }   // unknown block type
+        }
+
+        // Overflow-safe form of '(off + payload) > map_size'.
+        size_t off = (size_t)(uintptr_t)(p_blocks[i].operand.raw);
+        if (  off > map_size || payload > (map_size - off)  )
+            goto __load_fault;
+
+        if ( string == p_blocks[i].type )
+            p_blocks[i].operand.str.p_str = (char*)(p_base + off);
+        else
+            p_blocks[i].operand.raw = (void*)(p_base + off);
+
+        // The offset is in-bounds; now vet the operand CONTENTS. The generator
+        //   and explain paths index fixed-size arrays straight off these fields,
+        //   so a bit-flipped file must be rejected here, not trusted there.
+        switch ( p_blocks[i].type ) {
+            case branch_root : {
+                fuzz_branch_root_t* p_broot = p_blocks[i].operand.p_branch;
+
+                // 'amount' names the LAST usable index into steps[]/weights[].
+                if ( p_broot->amount >= FUZZ_MAX_STEPS )
+                    goto __load_fault;
+
+                // Every selectable hop must land on a later block of this program
+                //   (the generator substitutes 1 for a zero step), and weighted
+                //   alias redirects must stay inside the alternative tables.
+                for ( size_t a = 0; a <= p_broot->amount; a++ ) {
+                    size_t hop = p_broot->steps[a] ? p_broot->steps[a] : 1;
+                    if ( (i + hop) >= p_rec->count )
+                        goto __load_fault;
+                    if ( p_broot->weighted && p_broot->alias[a] > p_broot->amount )
+                        goto __load_fault;
+                }
+                break;
+            }
+            case range       : {
+                fuzz_range_t* p_range = p_blocks[i].operand.p_range;
+
+                // A zero span/accept_limit would spin the sampler forever.
+                if (
+                       p_range->amount > FUZZ_MAX_PATTERN_RANGE_FRAGMENTS
+                    || p_range->span < 1
+                    || p_range->accept_limit < 1
+                )  goto __load_fault;
+                break;
+            }
+            case reference   : {
+                fuzz_reference_t* p_ref = p_blocks[i].operand.p_ref;
+
+                // Every saved reference was resolved at build time; an index at
+                //   or past the record's subcontext count is corruption, and so
+                //   is a sub-type outside the reference enum.
+                if (  p_ref->subctx_index >= p_rec->subcontexts_count
+                    || p_ref->type < ref_declaration || p_ref->type > ref_shuffle  )
+                    goto __load_fault;
+
+                // Length references render into a fixed stack scratch buffer in
+                //   the generator, so re-check the parser's per-type field width
+                //   table before trusting the stored lenopts.
+                if ( ref_count == p_ref->type ) {
+                    unsigned short width = (p_ref->lenopts).width;
+                    int width_problem = 1;   //an unknown length type stays a problem
+
+                    switch ( (p_ref->lenopts).type ) {
+                        case raw_big: case raw_little: {  width_problem = ( 0 == width || width > 8 );  break;  }
+                        case hexadecimal: case hex_upper: {  width_problem = ( width > 16 );  break;  }
+                        case binary      : {  width_problem = ( 0 == width || width > 64 );  break;  }
+                        case decimal     : {  width_problem = ( width > 20 );  break;  }
+                        case octal       : {  width_problem = ( width > 22 );  break;  }
+                    }
+
+                    if ( width_problem )
+                        goto __load_fault;
+                }
+                break;
+            }
+            default          : {  break;  }
+        }
+    }
+
+    // Rebuild the subcontext table, loading each nested sub-factory record.
+    if (
+           p_rec->subs_offset > map_size
+        || (p_rec->subcontexts_count * sizeof(fuzz_compiled_sub_t))
+            > (map_size - p_rec->subs_offset)
+    )  goto __load_fault;
+
+    fuzz_compiled_sub_t* p_subs = (fuzz_compiled_sub_t*)(p_base + p_rec->subs_offset);
+
+    for ( size_t s = 0; s < p_rec->subcontexts_count; s++ ) {
+        fuzz_subcontext_t* p_subctx = &(p_fact->subcontexts[p_fact->subcontexts_count]);
+        size_t canon = (size_t)(p_subs[s].intern_of);
+
+        p_subctx->hash = p_subs[s].hash;
+        p_subctx->intern_of = canon;
+        memcpy(  &(p_subctx->label[0]), &(p_subs[s].label[0]),
+            FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH  );
+
+        // Interned entries re-borrow the canonical slot's already-loaded factory;
+        //   a canonical index that doesn't point backwards or at itself is corruption.
+        if ( canon == s )
+            p_subctx->p_factory =
+                __factory_load_at( p_base, map_size, p_subs[s].factory_offset, (depth + 1) );
+        else if ( canon < s )
+            p_subctx->p_factory = (p_fact->subcontexts[canon]).p_factory;
+        else
+            goto __load_fault;
+
+        if ( NULL == p_subctx->p_factory )
+            goto __load_fault;
+
+        p_fact->subcontexts_count++;
+    }
+
+    // Compiled files carry only the program; the constant-prefix bake is a pure
+    //   function of it, so re-derive it here rather than serializing the bytes.
+    __bake_constant_prefix( p_fact );
+
+    return p_fact;
+
+    __load_fault:
+        // Partial trees are safe to hand to the regular delete: mapped factories
+        //   never free node or operand memory, only their own struct and children.
+        PatternFactory__delete( p_fact );
+        return NULL;
+}
+
+
+// Load a compiled factory file. See the header for the ownership semantics.
+fuzz_factory_t* PatternFactory__load_mmap( const char* p_path, fuzz_error_t** pp_err ) {
+    if ( pp_err && NULL == *pp_err )
+        *pp_err = Error__new();
+
+    if ( NULL == p_path )  return NULL;
+
+    int fd = open( p_path, O_RDONLY );
+    if ( -1 == fd ) {
+        if ( pp_err )
+            Error__add( *pp_err, 0, 0, FUZZ_ERROR_INVALID_SYNTAX,
+                "Unable to open the compiled pattern file" );
+        return NULL;
+    }
+
+    struct stat file_info;
+    if (  -1 == fstat( fd, &file_info )
+        || (size_t)file_info.st_size < sizeof(fuzz_compiled_header_t)  ) {
+        close( fd );
+        if ( pp_err )
+            Error__add( *pp_err, 0, 0, FUZZ_ERROR_INVALID_SYNTAX,
+                "The compiled pattern file is missing or truncated" );
+        return NULL;
+    }
+
+    size_t map_size = (size_t)file_info.st_size;
+
+    // Private mapping: the fixup pass below writes relocated pointers into
+    //   copy-on-write pages without ever touching the file itself.
+    void* p_map = mmap( NULL, map_size, (PROT_READ | PROT_WRITE), MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( MAP_FAILED == p_map ) {
+        if ( pp_err )
+            Error__add( *pp_err, 0, 0, FUZZ_ERROR_INVALID_SYNTAX,
+                "Unable to map the compiled pattern file" );
+        return NULL;
+    }
+
+    fuzz_compiled_header_t* p_hdr = (fuzz_compiled_header_t*)p_map;
+    if (
+           FUZZ_COMPILED_MAGIC != p_hdr->magic
+        || FUZZ_COMPILED_VERSION != p_hdr->version
+        || sizeof(fuzz_pattern_block_t) != p_hdr->block_size
+        || map_size < p_hdr->file_size
+    ) {
+        munmap( p_map, map_size );
+        if ( pp_err )
+            Error__add( *pp_err, 0, 0, FUZZ_ERROR_INVALID_SYNTAX,
+                "The compiled pattern file has a bad or incompatible header" );
+        return NULL;
+    }
+
+    fuzz_factory_t* p_fact =
+        __factory_load_at( (unsigned char*)p_map, map_size, p_hdr->root_offset, 0 );
+
+    if ( NULL == p_fact ) {
+        munmap( p_map, map_size );
+        if ( pp_err )
+            Error__add( *pp_err, 0, 0, FUZZ_ERROR_INVALID_SYNTAX,
+                "The compiled pattern file contents failed validation" );
+        return NULL;
+    }
+
+    // The ROOT factory alone carries the mapping handle for cleanup.
+    p_fact->p_map_base = p_map;
+    p_fact->map_size = map_size;
+
+    return p_fact;
+}
+////////////////////////////////////////////////////////////////////////////////////
+
+
+
+// Precompute the byte-sampling table for a fully-parsed range. Every character the
+//   range can produce gets an equal share of the accepted random byte values; bytes
+//   at or above 'accept_limit' are rejected at generation time, which keeps the
+//   distribution over the character set exactly uniform (no modulo bias).
+static void __range_build_lut( fuzz_range_t* p_range ) {
+    if ( NULL == p_range || p_range->amount < 1 )  return;
+
+    // Expand the fragments into a flat list of candidate characters.
+    unsigned char p_chars[FUZZ_MAX_PATTERN_RANGE_FRAGMENTS*256];
+    size_t span = 0;
+
+    for ( size_t i = 0; i < p_range->amount && i < FUZZ_MAX_PATTERN_RANGE_FRAGMENTS; i++ ) {
+        fuzz_repetition_t* p_frag = &(p_range->fragments[i]);
+        unsigned short high = (0 != p_frag->single) ? p_frag->base : p_frag->high;
+
+        for ( unsigned short c = p_frag->base; c <= high && c <= 255; c++ )
+            p_chars[span++] = (unsigned char)c;
+    }
+
+    if ( span < 1 )  return;
+
+    p_range->span = (unsigned short)span;
+
+    if ( span > 256 ) {
+        // Overlapping fragments can list more than 256 candidates. Spread the byte
+        //   space across them directly; the duplicates already skew the weights.
+        p_range->accept_limit = 256;
+        for ( size_t b = 0; b < 256; b++ )
+            p_range->lut[b] = p_chars[(b * span) >> 8];
+    } else {
+        p_range->accept_limit = (unsigned short)((256 / span) * span);
+        for ( size_t b = 0; b < p_range->accept_limit; b++ )
+            p_range->lut[b] = p_chars[b % span];
+    }
+}
+
+
+
 // Define a set of functional or syntactically special characters.
 static const char special_chars[] = "?*|\\[{(<>)}]";
 // Macro to register a fuzz error inside a fuzz_ctx (the pattern_parse func mainly).
@@ -598,7 +1749,7 @@ static const char special_chars[] = "?*|\\[{(<>)}]";
 
 // Internal, recursive pattern parsing. This is called recursively generally
 //   when the nesting level () changes.
-static List_t* __parse_pattern(
+static fuzz_block_seq_t* __parse_pattern(
     fuzz_parser_ctx_t* const p_ctx,
     const char* p_pattern
 ) {
@@ -606,13 +1757,21 @@ static List_t* __parse_pattern(
     size_t len, nest_level, was_repetition;
     const char* p;
     const char* p_lvl0_sub;   // see the '<' section for variable declarations
-    List_t* p_seq;
+    fuzz_block_seq_t* p_seq;
 
     // Self-describing flags for branching mechanisms. TODO: ew
     uint8_t is_branching = 0;
 
     fuzz_pattern_block_t* p_branch_root_block = NULL;
     fuzz_branch_root_t* p_branch_root = NULL;
+    size_t branch_root_index = 0;   // position of ^ within this frame's sequence
+
+    // Staged branch weights ('<*N>'): one for the frame-opening first alternative
+    //   (held until the first '|' forges the root) and one for the alternative
+    //   directly after the most recent '|'.
+    unsigned short alt0_weight = 0;
+    size_t alt0_origin = FUZZ_BLOCK_SEQ_UNTRACKED;   // seq position the staged weight must annotate
+    unsigned short pending_alt_weight = 0;
 
     len = strnlen( p_pattern, (FUZZ_MAX_PATTERN_LENGTH-1) );
     nest_level = p_ctx->nest_level;
@@ -620,7 +1779,11 @@ static List_t* __parse_pattern(
 
     p = p_pattern;
     p_lvl0_sub = NULL;
-    p_seq = List__new( FUZZ_MAX_PATTERN_LENGTH );
+    p_seq = __blockseq_new();
+
+    // Anything the tracker holds for this depth right now belongs to some OTHER
+    //   frame's sequence (a sibling subsequence); its recorded index is meaningless here.
+    *((p_ctx->p_nest_tracker_idx)+nest_level) = FUZZ_BLOCK_SEQ_UNTRACKED;
 
     // Let's go!
     //   TODO: Spaghetti. Need to refactor quite a few things here once the application is operational.
@@ -684,9 +1847,10 @@ static List_t* __parse_pattern(
                     p++;   //skips over the character being escaped since it's been handled
                 }
 
-                p_new_block->data = (char*)calloc( 2, sizeof(char) );
-                *((char*)(p_new_block->data)) = final;
-                *((char*)(p_new_block->data)+1) = '\0';
+                p_new_block->operand.str.p_str = (char*)calloc( 2, sizeof(char) );
+                *(p_new_block->operand.str.p_str) = final;
+                *(p_new_block->operand.str.p_str+1) = '\0';
+                p_new_block->operand.str.length = 1;
 
                 break;
             }
@@ -722,7 +1886,7 @@ static List_t* __parse_pattern(
                     // A new branch is starting since the lexer was not currently branching
                     p_branch_root_block = p_new_block;
                     p_branch_root = (fuzz_branch_root_t*)calloc( 1, sizeof(fuzz_branch_root_t) ); //new root
-                    p_new_block->data = p_branch_root;
+                    p_new_block->operand.p_branch = p_branch_root;
                     p_new_block->type = branch_root;
 
                     // The first pipe always auto-includes the first element as being 1 unit from the root.
@@ -730,18 +1894,37 @@ static List_t* __parse_pattern(
                     p_branch_root->amount = 0;   //first one's on the house :)
                     p_branch_root->steps[0] = 1;
 
-                    // Add in the new branch root behind the most recent node.
-                    size_t loc = List__index_of( p_seq, p_prev );
+                    // A weight staged at the frame's opening belongs to this first
+                    //   alternative -- but only when that alternative is actually the
+                    //   block the weight was written in front of.
+                    if ( alt0_weight > 0 ) {
+                        if (  alt0_origin != *((p_ctx->p_nest_tracker_idx)+nest_level)  ) {
+                            free( p_branch_root );
+                            p_branch_root = NULL;
+                            FUZZ_ERR_IN_CTX( "Branch weights '<*N>' must directly precede"
+                                " the branch's first alternative" );
+                        }
 
-                    if (  -1 == List__add_at( p_seq, p_new_block, loc )  ) {
-                        FUZZ_ERR_IN_CTX( "Failed to add a branch '|' root to the node sequence" );
+                        p_branch_root->weights[0] = alt0_weight;
+                        p_branch_root->weighted = 1;
+                        alt0_weight = 0;
                     }
 
-                    // Get the index of the root and make sure it was inserted.
-                    if (  List__index_of( p_seq, p_new_block ) < 0  ) {
-                        FUZZ_ERR_IN_CTX( "Problem initializing the new branch '|' mechanism" );
+                    // Add in the new branch root behind the most recent node. The tracker
+                    //   bookkeeping already knows where that node sits, so no scan is needed;
+                    //   a sentinel here means 'p_prev' is a stale sibling-frame pointer and
+                    //   the insert correctly fails out-of-bounds.
+                    size_t loc = *((p_ctx->p_nest_tracker_idx)+nest_level);
+
+                    if (  -1 == __blockseq_add_at( p_seq, p_new_block, loc )  ) {
+                        FUZZ_ERR_IN_CTX( "Failed to add a branch '|' root to the node sequence" );
                     }
 
+                    // Remember where the root landed, and account for the tracked
+                    //   node getting shifted up one slot by the insert.
+                    branch_root_index = loc;
+                    (*((p_ctx->p_nest_tracker_idx)+nest_level))++;
+
                     // Init the new block.
                     p_new_block = NEW_PATTERN_BLOCK;
                     (p_new_block->count).single = 1;
@@ -751,7 +1934,7 @@ static List_t* __parse_pattern(
 
                 // This is a middle-of-the-branch OR '|'
                 p_new_block->type = branch_jmp;
-                p_new_block->data = (size_t*)calloc( 1, sizeof(size_t) );   //filled retroactively later
+                p_new_block->operand.step = 0;   //filled retroactively later, stored inline
 
                 // Set the branching flag to '3' to indicate that this is a fresh pipe '|' char (see below).
                 is_branching = 3;
@@ -828,7 +2011,7 @@ static List_t* __parse_pattern(
                 // Spin up the new block and attach the new reference data.
                 p_new_block = NEW_PATTERN_BLOCK;
                 p_new_block->type = reference;
-                p_new_block->data = p_ref;
+                p_new_block->operand.p_ref = p_ref;
                 (p_new_block->count).single = 1;
                 (p_new_block->count).base = 1;
                 (p_new_block->count).high = 1;
@@ -866,14 +2049,12 @@ static List_t* __parse_pattern(
                         // NOTE: While <$XYZ> _can_ follow a range mechanism, the range will simply be ignored.
                         //       This is the same as the ability to chain ranges but keep the final one.
                         // TODO: ^ Fix by setting the nest_level ptr to NULL when a range is applied??
-                        void* p_last = List__get_last( p_seq );
-                        fuzz_pattern_block_t* p_ret = (NULL != p_last) ? (fuzz_pattern_block_t*)p_last : NULL;
+                        fuzz_pattern_block_t* p_ret = __blockseq_last( p_seq );
 
                         if (   // kill me
                                ( NULL == *((p_ctx->p_nest_tracker)+nest_level) )
                             || ( sub != (*((p_ctx->p_nest_tracker)+nest_level))->type )
                             || NULL == p_ret
-                            || NULL == p_ret->data
                             || ( ret != p_ret->type )
                         ) {
                             VAR_ERR( "Declarations '<$...>' can only be applied to subsequence '()' mechanisms" );
@@ -901,17 +2082,15 @@ static List_t* __parse_pattern(
 
                         // Now need to drop all the blocks added by this sub's/declaration's () content,
                         //   since it will reside in its own context.
-                        // The count of list items to be deleted lives in the data of the 'ret' pattern
+                        // The count of list items to be deleted lives in the operand of the 'ret' pattern
                         //   block, +1 for the 'ret' itself, and ultimately +1 for the preceding 'sub' block.
-                        for ( size_t del = (*((size_t*)(p_ret->data)) + 2); del > 0; del-- ) {
-                            void* p_popped = List__remove_last( p_seq );
+                        for ( size_t del = (p_ret->operand.step + 2); del > 0; del-- ) {
+                            fuzz_pattern_block_t* p_popped = __blockseq_remove_last( p_seq );
 
                             // It should be OK to free these resources since the new variable declaration
                             //   is spawning a totally separate pattern factory with separate allocations.
                             if ( NULL != p_popped ) {
-                                fuzz_pattern_block_t* p_popped_block = (fuzz_pattern_block_t*)p_popped;
-                                if ( NULL != p_popped_block->data )
-                                    free( p_popped_block->data );
+                                __pattern_block_free_operand( p_popped );
                                 free( p_popped );
                             }
                         }
@@ -925,14 +2104,37 @@ static List_t* __parse_pattern(
                             VAR_ERR( "Error in variable declaration '<$...>' statement." );
                         }
 
-                        // Create the generator context.
-                        fuzz_gen_ctx_t* p_gctx = Generator__new_context( p_ff );
+                        // Intern structurally identical declarations: when an earlier variable
+                        //   already compiled to this exact program, share its factory instead of
+                        //   keeping a private copy. The cached structural hashes short-circuit
+                        //   the scan; a hash hit is confirmed with a deep comparison.
+                        size_t intern_of = p_ctx->subcontexts_count;
+                        unsigned long struct_hash = __factory_structural_hash( p_ff );
+
+                        for ( size_t i = 0; i < p_ctx->subcontexts_count; i++ ) {
+                            if (
+                                   struct_hash == p_ctx->subfactory_hashes[i]
+                                && i == (p_ctx->subcontexts[i]).intern_of
+                                && __factory_structurally_equal( p_ff, (p_ctx->subcontexts[i]).p_factory )
+                            ) {
+                                intern_of = i;
+                                break;
+                            }
+                        }
+
+                        if ( intern_of != p_ctx->subcontexts_count ) {
+                            PatternFactory__delete( p_ff );
+                            p_ff = (p_ctx->subcontexts[intern_of]).p_factory;
+                        }
 
                         // Attach the subcontext to the parent context/factory. Uses the variable hash
-                        //   as an indexer for faster lookups (hopefully).
+                        //   as an indexer for faster lookups (hopefully). Generator contexts for the
+                        //   sub-factory are per-run state and get built alongside each gen ctx.
                         fuzz_subcontext_t* p_subctx = &(p_ctx->subcontexts[p_ctx->subcontexts_count]);
                         p_subctx->hash = hash;
-                        p_subctx->p_gen_ctx = p_gctx;
+                        p_subctx->p_factory = p_ff;
+                        p_subctx->intern_of = intern_of;
+                        p_ctx->subfactory_hashes[p_ctx->subcontexts_count] = struct_hash;
                         memcpy(  &(p_subctx->label[0]), p_varname,
                             strnlen( p_varname, (FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH-1) )  );
 
@@ -1087,12 +2289,78 @@ static List_t* __parse_pattern(
                             free( (void*)p_lenopts );
                             p_ref->type = ref_count;
 
+                            // Precompile the fixed-width wrap modulus so the generator
+                            //   never recomputes it per rendered length field. The
+                            //   multiplier-vs-64-bits rule mirrors the render widths.
+                            (p_ref->lenopts).wrap = 0;
+                            if ( (p_ref->lenopts).width > 0 ) {
+                                unsigned short w = (p_ref->lenopts).width;
+
+                                switch ( (p_ref->lenopts).type ) {
+                                    case decimal : {
+                                        if ( (10*w) < 64 ) {
+                                            unsigned long long wrap = 1;
+                                            for ( unsigned short i = 0; i < w; i++ )
+                                                wrap *= 10;
+                                            (p_ref->lenopts).wrap = wrap;
+                                        }
+                                        break;
+                                    }
+                                    case hexadecimal :
+                                    case hex_upper   : {
+                                        if ( (4*w) < 64 )
+                                            (p_ref->lenopts).wrap = (1ULL << (4*w));
+                                        break;
+                                    }
+                                    case octal : {
+                                        if ( (3*w) < 64 )
+                                            (p_ref->lenopts).wrap = (1ULL << (3*w));
+                                        break;
+                                    }
+                                    case binary : {
+                                        if ( w < 64 )
+                                            (p_ref->lenopts).wrap = (1ULL << w);
+                                        break;
+                                    }
+                                    default : break;   // raw types truncate via memcpy
+                                }
+                            }
+
                             *((p_ctx->p_nest_tracker)+nest_level) = p_new_block;
                             break;
                     }
 
+                    case '*' : {
+                        // Branch weights don't save onto the node chain; they annotate
+                        //   the NEXT alternative of a branch '|' mechanism.
+                        free( p_ref );
+                        p_ref = NULL;
+                        free( p_new_block );
+                        p_new_block = NULL;
+
+                        uint16_t weight = __get_valid_uint16( p_varname );
+                        if ( 0 == weight ) {
+                            VAR_ERR( "Branch weights '<*N>' must be a number from 1 to 65535" );
+                        }
+
+                        if ( 2 == is_branching ) {
+                            // Directly after a '|': weight the upcoming alternative.
+                            pending_alt_weight = weight;
+                        } else if ( 0 == is_branching && 0 == p_seq->count ) {
+                            // Frame opening: stage the weight for the first alternative,
+                            //   remembering where that alternative must begin.
+                            alt0_weight = weight;
+                            alt0_origin = p_seq->count;
+                        } else {
+                            VAR_ERR( "Branch weights '<*N>' must open an alternative: at the"
+                                " start of the pattern or subsequence, or directly after a branch '|'" );
+                        }
+
+                        break;
+                    }
+
                     default : {
-                        VAR_ERR( "Unrecognized variable '<>' statement type. Valid options are $, @, #, or %" );
+                        VAR_ERR( "Unrecognized variable '<>' statement type. Valid options are $, @, #, %, or *" );
                         break;
                     }
                 }
@@ -1129,8 +2397,9 @@ static List_t* __parse_pattern(
                 (p_range->fragments[0]).single = 0;
                 (p_range->fragments[0]).base = 0;
                 (p_range->fragments[0]).high = 255;
+                __range_build_lut( p_range );
 
-                p_new_block->data = p_range;
+                p_new_block->operand.p_range = p_range;
                 break;
             }
 
@@ -1271,15 +2540,16 @@ static List_t* __parse_pattern(
                 (p_new_block->count).high = 1;
                 *((p_ctx->p_nest_tracker)+nest_level) = p_new_block;
 
-                // Set the content of the sub's data to the length of its members.
-                size_t* p_lvl = (size_t*)calloc( 1, sizeof(size_t) );
-                *p_lvl = nest_level;
-                p_new_block->data = p_lvl;
+                // Set the content of the sub's operand to its nest level, stored inline.
+                p_new_block->operand.step = nest_level;
 
-                if (  -1 == List__add( p_seq, p_new_block )  ) {
+                if (  -1 == __blockseq_add( p_seq, p_new_block )  ) {
                     FUZZ_ERR_IN_CTX( "Subsequence '()' failed to add onto the factory node chain" );
                 }
 
+                // Record where the tracked 'sub' block sits for branch bookkeeping.
+                *((p_ctx->p_nest_tracker_idx)+nest_level) = (p_seq->count - 1);
+
                 p_new_block = NULL;   //this should be done to prevent double-frees or dangles
 
 
@@ -1294,43 +2564,38 @@ static List_t* __parse_pattern(
                     p_lvl0_sub = strdup( p_sub );
 
                 (p_ctx->nest_level)++;   // increase the nest level and enter
-                List_t* p_pre = __parse_pattern( p_ctx, p_sub );
+                fuzz_block_seq_t* p_pre = __parse_pattern( p_ctx, p_sub );
                 (p_ctx->nest_level)--;   // ... and now leave the nest
                 free( p_sub );
 
-                // Make sure the returned list has some nodes. If not, problem.
-                if (  NULL == p_pre || List__length( p_pre ) < 1  ) {
-                    if (  List__length( p_pre ) > 0  )
-                        List__delete_deep( &p_pre );
+                // Make sure the returned sequence has some nodes. If not, problem.
+                if (  NULL == p_pre || p_pre->count < 1  ) {
+                    __blockseq_delete_deep( p_pre );
                     FUZZ_ERR_IN_CTX( "Invalid, empty, or NULL branch inside Subsequence '()' statement" );
                 }
 
-                // Also ensure the returned list doesn't end with a branch. Remember, HEAD is last node.
-                fuzz_pattern_block_t* p_x = (fuzz_pattern_block_t*)(List__get_last( p_pre ));
+                // Also ensure the returned sequence doesn't end with a branch.
+                fuzz_pattern_block_t* p_x = __blockseq_last( p_pre );
                 if ( branch_root == p_x->type || branch_jmp == p_x->type ) {
-                    if (  List__length( p_pre ) > 0  )
-                        List__delete_deep( &p_pre );
+                    __blockseq_delete_deep( p_pre );
                     FUZZ_ERR_IN_CTX( "Subsequence '()' statements cannot end with branch '|' mechanisms" );
                 }
 
                 // At this point, essentially linearly staple the output of the sub in memory.
-                if (  -1 == List__extend( p_seq, p_pre )  ) {
-                    if (  List__length( p_pre ) > 0  )
-                        List__delete_deep( &p_pre );
+                if (  -1 == __blockseq_extend( p_seq, p_pre )  ) {
+                    __blockseq_delete_deep( p_pre );
                     FUZZ_ERR_IN_CTX( "Subsequence '()' mechanism failed to add onto the instruction set" );
                 }
 
-                size_t rev_size = List__length( p_pre );
-                List__delete_shallow( &p_pre );
+                size_t rev_size = p_pre->count;
+                __blockseq_delete_shallow( p_pre );
 
                 // Create the ret node and point it back to 'p_new_block'.
                 fuzz_pattern_block_t* p_ret = NEW_PATTERN_BLOCK;
                 // *(p_nest_tracker+nest_level) = p_new_block; //<- DO NOT
                 p_ret->type = ret;
 
-                size_t* p_sz = (size_t*)calloc( 1, sizeof(size_t) );
-                *p_sz = rev_size;   //how many nodes to wade backward through
-                p_ret->data = p_sz;
+                p_ret->operand.step = rev_size;   //how many nodes to wade backward through
 
                 p_new_block = p_ret;
 
@@ -1372,7 +2637,8 @@ static List_t* __parse_pattern(
                 *((p_ctx->p_nest_tracker)+nest_level) = p_new_block;
                 char* z = (char*)strndup( start, (p-start+1) );
                 p_new_block->type = string;
-                p_new_block->data = z;
+                p_new_block->operand.str.p_str = z;
+                p_new_block->operand.str.length = strlen( z );   //cache once at parse time
                 (p_new_block->count).single = 1;
                 (p_new_block->count).base = 1;
                 (p_new_block->count).high = 1;
@@ -1380,10 +2646,11 @@ static List_t* __parse_pattern(
                 // If a static character is hit at the end of a branch and its >1 char long,
                 //   snip the string and reset p. The '2==is_...' means this string is JUST AFTER
                 //   a branch '|' mechanism (next-in-line).
-                if ( strlen(z) > 1 && 2 == is_branching ) {
+                if ( p_new_block->operand.str.length > 1 && 2 == is_branching ) {
                     char* x = (char*)calloc( 2, sizeof(char) );
                     *x = *start; *(x+1) = '\0';
-                    p_new_block->data = x;
+                    p_new_block->operand.str.p_str = x;
+                    p_new_block->operand.str.length = 1;
                     free( z );
                     p = start;
                 }
@@ -1392,19 +2659,23 @@ static List_t* __parse_pattern(
             }
         }
 
-        // Add the (maybe-)populated node onto the list and continue;
+        // Add the (maybe-)populated node onto the sequence and continue;
         if ( NULL != p_new_block ) {
-            if (  -1 == List__add( p_seq, p_new_block )  ) {
+            if (  -1 == __blockseq_add( p_seq, p_new_block )  ) {
                 FUZZ_ERR_IN_CTX( "Failed to add the pattern block onto the factory sequence" );
             }
 
+            // If the tracked block for this level is what just went on, note its position.
+            if ( p_new_block == *((p_ctx->p_nest_tracker)+nest_level) )
+                *((p_ctx->p_nest_tracker_idx)+nest_level) = (p_seq->count - 1);
+
             // Doesn't matter where or when, if current branch mark is '2' then update branch_root.
             //   A value of '2' indicates a block coming directly after a '|'.
             if ( 2 == is_branching ) {
                 // Increment and check bound.
                 (p_branch_root->amount)++;
                 if ( p_branch_root->amount > FUZZ_MAX_STEPS ) {
-                    void* p_most_recent = List__remove_last( p_seq );
+                    fuzz_pattern_block_t* p_most_recent = __blockseq_remove_last( p_seq );
                     if ( NULL != p_most_recent )
                         free( p_most_recent );
 
@@ -1412,13 +2683,12 @@ static List_t* __parse_pattern(
                         " Consider simplifying your pattern" );
                 }
 
-                fuzz_pattern_block_t* p_curr = *((p_ctx->p_nest_tracker)+nest_level);
-
-                int track_index = List__index_of( p_seq, p_curr );
-                int root_index = List__index_of( p_seq, p_branch_root_block );
+                // Both positions are already known from the running bookkeeping.
+                size_t track_index = *((p_ctx->p_nest_tracker_idx)+nest_level);
+                size_t root_index = branch_root_index;
 
-                if ( track_index <= root_index || -1 == root_index ) {
-                    void* p_most_recent = List__remove_last( p_seq );
+                if ( track_index <= root_index || track_index >= p_seq->count ) {
+                    fuzz_pattern_block_t* p_most_recent = __blockseq_remove_last( p_seq );
                     if ( NULL != p_most_recent )
                         free( p_most_recent );
 
@@ -1430,10 +2700,17 @@ static List_t* __parse_pattern(
                 size_t delta = track_index - root_index;
                 p_branch_root->steps[p_branch_root->amount] = (unsigned short)(delta & 0xFFFF);
 
+                // Attach any weight staged by a '<*N>' between the '|' and this block.
+                if ( pending_alt_weight > 0 ) {
+                    p_branch_root->weights[p_branch_root->amount] = pending_alt_weight;
+                    p_branch_root->weighted = 1;
+                    pending_alt_weight = 0;
+                }
+
             } else if ( 1 == is_branching ) {
                 // Go back and mark the branch jmp types with the proper distance from this node.
-                if (  !__branch_write_end( p_seq, p_branch_root_block, p_ctx, 0 )  ) {
-                    void* p_most_recent = List__remove_last( p_seq );
+                if (  !__branch_write_end( p_seq, p_branch_root_block, branch_root_index, p_ctx, 0 )  ) {
+                    fuzz_pattern_block_t* p_most_recent = __blockseq_remove_last( p_seq );
                     if ( NULL != p_most_recent )
                         free( p_most_recent );
 
@@ -1460,7 +2737,7 @@ static List_t* __parse_pattern(
                 p_lvl0_sub = NULL;
             }
 
-            // Even on crashes, collate the list so its contents can be deleted properly.
+            // Even on crashes, collate the sequence so its contents can be deleted properly.
             fuzz_factory_t* x = __compress_List_to_factory( p_seq );
             PatternFactory__delete( x );
             return NULL;
@@ -1475,7 +2752,7 @@ static List_t* __parse_pattern(
     //   it will become '1', which doesn't give the opportunity for the 'else-if'
     //   above to run for that branch.
     if ( is_branching > 0 ) {
-        if (  !__branch_write_end( p_seq, p_branch_root_block, p_ctx, 1 )  ) {
+        if (  !__branch_write_end( p_seq, p_branch_root_block, branch_root_index, p_ctx, 1 )  ) {
             p_err_msg = "Problem closing branch '|' mechanism";
             goto __err_post_loop;
         }
@@ -1488,20 +2765,24 @@ static List_t* __parse_pattern(
         p_lvl0_sub = NULL;
     }
 
-    // Also ensure the returned list doesn't end with a branch. Remember, HEAD is last node.
-    fuzz_pattern_block_t* p_x = (fuzz_pattern_block_t*)(List__get_last( p_seq ));
-    if ( branch_root == p_x->type || branch_jmp == p_x->type ) {
+    // A weight staged at the frame's opening never met its branch.
+    if ( alt0_weight > 0 ) {
+        p_err_msg = "Branch weights '<*N>' require a branch '|' mechanism";
+        goto __err_post_loop;
+    }
+
+    // Also ensure the returned sequence doesn't end with a branch.
+    fuzz_pattern_block_t* p_x = __blockseq_last( p_seq );
+    if (  NULL != p_x && (branch_root == p_x->type || branch_jmp == p_x->type)  ) {
         p_err_msg = "The input pattern cannot end with branch '|' mechanisms";
         goto __err_post_loop;
     }
 
-    // Return the linked list representing the sequence of generation.
-    if (  List__length( p_seq ) > 0  ) {
+    // Return the block sequence representing the order of generation.
+    if ( NULL != p_seq && p_seq->count > 0 ) {
         return p_seq;
     } else {
-        if ( NULL != p_seq )
-            List__delete_deep( &p_seq );
-
+        __blockseq_delete_deep( p_seq );
         return NULL;
     }
 
@@ -1908,8 +3189,11 @@ static inline int __range_parse_range( fuzz_pattern_block_t* const p_pattern_blo
     if ( amount <= 0 )  goto __range_parse_error;
     p_range->amount = amount;
 
-    // Assign the range to the pattern block's data and return "OK".
-    p_pattern_block->data = (void*)p_range;
+    // Precompute the bulk-sampling table now that the fragments are final.
+    __range_build_lut( p_range );
+
+    // Assign the range to the pattern block's operand and return "OK".
+    p_pattern_block->operand.p_range = p_range;
     return 1;
 
 
@@ -1922,41 +3206,100 @@ static inline int __range_parse_range( fuzz_pattern_block_t* const p_pattern_blo
 
 
 // Terminate the current branch and back-fill the jmp nodes.
+// Precompute the Walker alias table for a weighted branch root. Each of the
+//   n alternatives gets a column holding an acceptance threshold and an alias:
+//   the generator draws a uniform column, then one more draw either keeps it or
+//   redirects to its alias -- O(1) per branch with two table reads, no cumulative
+//   scan, regardless of how many alternatives (up to FUZZ_MAX_STEPS) are in play.
+//   Thresholds are 64-bit fixed-point fractions, so the realized distribution
+//   matches the requested weights exactly (no float rounding drift).
+static void __branch_build_alias( fuzz_branch_root_t* p_root ) {
+    if ( !p_root->weighted )  return;
+
+    size_t n = (p_root->amount + 1);   // alternatives, not separators
+    const __uint128_t one = ((__uint128_t)1 << 64);
+
+    // Scale each weight to n/total in 64.64 fixed point. Weights top out at
+    //   65535 and n at 32, so the products stay far within 128 bits.
+    __uint128_t scaled[FUZZ_MAX_STEPS];
+    unsigned char underfull[FUZZ_MAX_STEPS], overfull[FUZZ_MAX_STEPS];
+    size_t n_under = 0, n_over = 0;
+
+    unsigned long long total = 0;
+    for ( size_t i = 0; i < n; i++ )
+        total += ( p_root->weights[i] ? p_root->weights[i] : 1 );
+
+    for ( size_t i = 0; i < n; i++ ) {
+        unsigned long long w = ( p_root->weights[i] ? p_root->weights[i] : 1 );
+        scaled[i] = (  ( ((__uint128_t)w) * n ) << 64  ) / total;
+
+        if ( scaled[i] < one )  underfull[n_under++] = (unsigned char)i;
+        else                    overfull[n_over++] = (unsigned char)i;
+    }
+
+    // Pair each underfull column with an overfull donor until every column
+    //   holds exactly one unit of probability mass.
+    while ( n_under > 0 && n_over > 0 ) {
+        unsigned char u = underfull[--n_under];
+        unsigned char o = overfull[--n_over];
+
+        p_root->accept[u] = (uint64_t)scaled[u];
+        p_root->alias[u] = o;
+
+        scaled[o] -= (one - scaled[u]);
+        if ( scaled[o] < one )  underfull[n_under++] = o;
+        else                    overfull[n_over++] = o;
+    }
+
+    // Whatever remains is exactly full (modulo the last rounding bit): always accept.
+    while ( n_over > 0 ) {
+        unsigned char o = overfull[--n_over];
+        p_root->accept[o] = UINT64_MAX;
+        p_root->alias[o] = o;
+    }
+    while ( n_under > 0 ) {
+        unsigned char u = underfull[--n_under];
+        p_root->accept[u] = UINT64_MAX;
+        p_root->alias[u] = u;
+    }
+}
+
 static int __branch_write_end(
-    List_t* p_seq,
+    fuzz_block_seq_t* p_seq,
     fuzz_pattern_block_t* p_branch_root_block,
+    size_t root_index,
     fuzz_parser_ctx_t* const p_ctx,
     int is_post_run
 ) {
 printf( "P1 |%d|\n", is_post_run );
-    // Preliminary checks.
+    // Preliminary checks. The root's position is handed in by the caller's
+    //   bookkeeping; just confirm it actually points at the root block.
     if ( NULL == p_ctx || NULL == p_branch_root_block || NULL == p_seq )  return 0;
+    if (
+           root_index >= p_seq->count
+        || p_branch_root_block != *((p_seq->pp_blocks)+root_index)
+    )  return 0;
 
     // Get the branch root data from the block.
-    fuzz_branch_root_t* p_branch_root =
-        ((fuzz_branch_root_t*)(p_branch_root_block->data));
+    fuzz_branch_root_t* p_branch_root = p_branch_root_block->operand.p_branch;
     if ( NULL == p_branch_root )  return 0;
 
-    // Get the index of the branch root so relative operations can be done on the branch.
-    int root_index = List__index_of( p_seq, p_branch_root_block );
-    if ( -1 == root_index )  return 0;
-
     // Shorten the wooly name of the tracked node.
     fuzz_pattern_block_t* p_track_block =
         *((p_ctx->p_nest_tracker)+(p_ctx->nest_level));
 
     // Now need to seek the distance up to one of two points:
-    //   1. The end of the linked list of pattern blocks (up to the most recent instruction).
+    //   1. The end of the sequence of pattern blocks (up to the most recent instruction).
     //   2. If the most recent node that's closing the branch (remember: this is the END of
     //       a branch statement, so 1 == is_branching) is a 'sub' pattern block type, the
     //       distance to the 'end' starts at the BEGINNING of the sub, not the ending 'ret'
     //       after the recursion appends all the sub-items.
     //         EX: a|b|c(defg) --> |a.b.c+ rather than |a.b.c(defg[ret]+
 
-    // Get the most recently-tracked block per the nest-level, or the final list nodes' index.
-    int last_pattern_block = List__index_of( p_seq, p_track_block );
-    if ( -1 == last_pattern_block )
-        last_pattern_block = (List__length( p_seq ) - 1);
+    // Get the most recently-tracked block's index per the nest-level, or the final node's.
+    size_t last_pattern_block = *((p_ctx->p_nest_tracker_idx)+(p_ctx->nest_level));
+    if ( NULL == p_track_block || last_pattern_block >= p_seq->count )
+        last_pattern_block = (p_seq->count - 1);
 
     // Bounds checking.
     if ( last_pattern_block <= root_index )  return 0;
@@ -1968,26 +3311,28 @@ printf( "P1 |%d|\n", is_post_run );
 
         unsigned short move = p_branch_root->steps[i] - 1;
 
-        //printf( "--- %d,%d,%hu,%hu\n", root_index, last_pattern_block, move, p_branch_root->steps[i] );
-        void* _p_block = List__get_at(  p_seq, (root_index + move)  );
-        if ( NULL == _p_block )  return 0;
+        //printf( "--- %lu,%lu,%hu,%hu\n", root_index, last_pattern_block, move, p_branch_root->steps[i] );
+        if ( (root_index + move) >= p_seq->count )  return 0;
 
-        fuzz_pattern_block_t* p_block = (fuzz_pattern_block_t*)_p_block;
-        if ( branch_jmp != p_block->type )  return 0;
+        fuzz_pattern_block_t* p_block = *((p_seq->pp_blocks)+(root_index + move));
+        if ( NULL == p_block || branch_jmp != p_block->type )  return 0;
 
         // Set the amount for the jmp. The position of the jmp block is (root_index+move),
-        //   so really we only need to get the position to the end of the current list since this
-        //   function is called _AS THE LIST IS CONSTRUCTING_. This value must be incremented
-        //   once if this is a post-run (because the final jmp-to block such as 'end' or 'ret' has
-        //   not yet been added onto the list.
-        *((size_t*)(p_block->data)) = (
-            (List__length( p_seq ) - 1)
+        //   so really we only need to get the position to the end of the current sequence since
+        //   this function is called _AS THE SEQUENCE IS CONSTRUCTING_. This value must be
+        //   incremented once if this is a post-run (because the final jmp-to block such as 'end'
+        //   or 'ret' has not yet been added onto the sequence).
+        p_block->operand.step = (
+            (p_seq->count - 1)
             - (root_index + move)
             + is_post_run
             //last_pattern_block - root_index - move + is_post_run
         );
     }
 
+    // The root is complete: bake the alias table for weighted selections.
+    __branch_build_alias( p_branch_root );
+
     // OK. Return success.
     return 1;
 }
@@ -10,6 +10,8 @@
 
 #include "fuzz_error.h"
 
+#include <stdint.h>
+
 #define NEW_PATTERN_BLOCK (fuzz_pattern_block_t*)calloc( 1, sizeof(fuzz_pattern_block_t) );
 
 // 16MB max pattern length. TODO: Reconsider as the project matures.
@@ -54,16 +56,21 @@ typedef enum _reference_type {
 
 
 
-// Simple structure to maintain hash-to-generator-context values for factory subcontexts.
+// Simple structure to maintain hash-to-sub-factory values for factory subcontexts.
+//   Like everything else in a built factory this is IMMUTABLE: all mutable per-run
+//   state (the sub-generator context and its scratch slab) lives in the generator
+//   context instead, so one compiled factory can serve any number of threads.
 typedef struct _fuzz_subcontext_reference_t {
     unsigned long hash;    //the hash for the reference name (using 'djb2')
     // The string used in declaring the name of the variable/subcontext.
     char label[FUZZ_MAX_PATTERN_LABEL_NAME_LENGTH];
-    // The generator context to use when shuffling the variable or initializing it.
-    void* p_gen_ctx;   // this pointer is a 'void' type to avoid circular dependencies...
-    // Maintain the most recently-generated subcontext data. This is never accessed outside
-    //   the parent factory's generator through variable references.
-    void* p_most_recent;   // same here
+    // The compiled sub-factory for the variable's declaration pattern.
+    struct _fuzz_factory_t* p_factory;
+    // Interning: when several variables compile to structurally identical programs
+    //   they all point at ONE shared factory. This names the canonical slot index
+    //   (equal to the slot's own index when it owns its factory); only canonical
+    //   slots free or serialize the factory underneath them.
+    size_t intern_of;
 } fuzz_subcontext_t;
 
 
@@ -81,6 +88,24 @@ typedef struct _fuzz_factory_t {
     fuzz_subcontext_t subcontexts[FUZZ_MAX_SUBCONTEXTS];
     // Amount of subcontexts currently attached.
     size_t subcontexts_count;
+    // Baked constant prefix: the run of fully deterministic blocks at the front of
+    //   the program, pre-rendered at compile/load time so every generation starts
+    //   with one memcpy instead of re-interpreting them. NULL/0 when the program
+    //   opens with a variable block. Heap-owned even for mapped factories.
+    unsigned char* p_const_prefix;
+    size_t const_prefix_len;
+    // Block index the interpreter resumes at after pasting the prefix.
+    size_t const_resume_index;
+    // Non-zero when the ENTIRE program baked: every output is byte-identical and
+    //   generation degenerates to the prefix copy alone.
+    unsigned char is_constant;
+    // Non-zero when node_seq and its operands point into a compiled-file mapping
+    //   rather than the heap; such factories never free individual operands.
+    int is_mapped;
+    // Root of the mapping (set ONLY on the top-level loaded factory) and its size,
+    //   so deletion munmaps the file exactly once.
+    void* p_map_base;
+    size_t map_size;
 } fuzz_factory_t;
 
 
@@ -102,6 +127,7 @@ typedef struct _fuzz_reference_lenopts_t {
     reference_length_type type;   /**< The type of reference length to output. */
     unsigned short width;   /**< The width of the variable field in the output binary/string. */
     long long int add;   /**< The amount to add/subtract with the length of the generated variable. */
+    unsigned long long wrap;   /**< Precompiled fixed-width wrap modulus; 0 means no wrapping. */
 } fuzz_reference_length_options_t;
 
 // A sub-structure which holds reference/variable information inside the final
@@ -114,6 +140,10 @@ typedef struct _fuzz_reference_t {
     unsigned long hash;
     // The sub-type for the reference.
     reference_type type;
+    // Index into the owning factory's subcontexts[] table, resolved ONCE when the
+    //   factory is built so the generator does a single array index per reference
+    //   instead of a label scan. FUZZ_MAX_SUBCONTEXTS marks an unresolved label.
+    size_t subctx_index;
     // The following OPTIONAL fields are only used (at the moment) for length references.
     fuzz_reference_length_options_t lenopts;
 } fuzz_reference_t;
@@ -137,24 +167,49 @@ typedef struct _fuzz_range_t {
     //   struct will be limited to a max (customizable) ranges amount.
     fuzz_repetition_t fragments[FUZZ_MAX_PATTERN_RANGE_FRAGMENTS];
     size_t amount;
+    // Bulk-sampling acceleration, precomputed once at parse time so generation
+    //   can turn every accepted PRNG byte directly into an output character.
+    unsigned short span;           // total character count across all fragments
+    unsigned short accept_limit;   // bytes >= this are rejected to stay bias-free
+    unsigned char lut[256];        // accepted random byte -> output character
 } fuzz_range_t;
 
 
 // Used in branch ROOT mechanisms to elect a forward-path in the node sequence.
+//   Alternatives can carry explicit weights ('<*N>'); those roots precompute a
+//   Walker alias table at parse time, so weighted selection stays O(1) per
+//   generation (two table reads) no matter how many alternatives are in play.
 typedef struct _fuzz_branch_root_t {
     unsigned short steps[FUZZ_MAX_STEPS];   // the different forward-step counts available
     size_t amount;   // how many steps are defined to choose from
+    unsigned short weights[FUZZ_MAX_STEPS];   // raw per-alternative weights; 0 means the default of 1
+    unsigned char weighted;   // non-zero when any alternative carries an explicit weight
+    unsigned char alias[FUZZ_MAX_STEPS];    // alias table: redirect target per column
+    uint64_t accept[FUZZ_MAX_STEPS];        // acceptance thresholds, 64-bit fixed-point fractions
 } fuzz_branch_root_t;
 
 
+// The per-block operand, stored INLINE in each instruction as a union rather than
+//   behind a scattered void pointer. Which member is live depends on the block type;
+//   'raw' exists for generic NULL tests and is aliased with every pointer member.
+typedef union _fuzz_block_operand_t {
+    void* raw;                      // generic pointer view (free/NULL checks)
+    struct {
+        char* p_str;                // [string] static content to emit
+        size_t length;              // [string] length cached at parse time
+    } str;
+    fuzz_range_t* p_range;          // [range] the range fragments to sample
+    fuzz_reference_t* p_ref;        // [reference] variable reference info
+    fuzz_branch_root_t* p_branch;   // [branch_root] forward-step table
+    size_t step;                    // [sub] nest tag; [ret] nodes back; [branch_jmp] nodes forward
+} fuzz_block_operand_t;
+
 // A block (or "piece") of an interpreted part of the input pattern information.
+//   Blocks are fixed-width instructions: the generator walks them as one contiguous
+//   cache-resident program with no per-block pointer chasing for inline operands.
 typedef struct _fuzz_pattern_block_t {
-    // Represents a pointer to the node's data.
-    //   This could point to a string, another List, etc. depending on the type.
-    //   If this pointer is NOT NULL, it is assumed the referenced data is free-able.
-    // TODO: Turn this into a union of all possible reference types, further reducing the
-    //        need for including unsafe and scattered void ptrs in the final factory.
-    void* data;
+    // The operand for this instruction (see above).
+    fuzz_block_operand_t operand;
     // How many times to produce this specific node's data. Defaults to 1.
     fuzz_repetition_t count;
     // The type of pattern block being constructed: string, reference, sub, etc.
@@ -176,6 +231,15 @@ void PatternFactory__explain( FILE* p_stream, fuzz_factory_t* p_fact );
 // Return the pointer to a generator context attached to a pattern factory as a subcontext.
 fuzz_subcontext_t* PatternFactory__get_subcontext( fuzz_factory_t* p_factory, char* p_label );
 
+// Serialize a compiled factory (with all of its sub-factories) into a versioned,
+//   relocatable file at the given path. Returns non-zero on success.
+int PatternFactory__save( fuzz_factory_t* p_fact, const char* p_path );
+
+// Load a factory previously written by PatternFactory__save. The file is mmap'd
+//   privately and pointer operands are fixed up in place (copy-on-write), so
+//   startup cost is near-zero regardless of how large the original schema was.
+fuzz_factory_t* PatternFactory__load_mmap( const char* p_path, fuzz_error_t** pp_err );
+
 
 
 #endif   /* NANOFUZZ_PATTERN_H */
@@ -0,0 +1,239 @@
+/*
+ * shm_ring.c
+ *
+ * Shared-memory ring output mode implementations.
+ *
+ */
+
+#define _GNU_SOURCE   /* memfd_create */
+
+#include "shm_ring.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+
+// The shared control page living at offset 0 of the memfd. The producer-side
+//   'head' and consumer-side 'tail' cursors are monotonic byte counts padded onto
+//   separate cache lines (same discipline as the in-process output ring), so the
+//   two processes never false-share while polling each other's progress.
+#define FUZZ_SHM_CACHE_LINE_SIZE 64
+typedef struct _fuzz_shm_ring_header_t {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t capacity;   // data region size in bytes (power of two)
+    char _pad0[FUZZ_SHM_CACHE_LINE_SIZE];
+    _Atomic uint64_t head;   // total bytes ever produced
+    char _pad1[FUZZ_SHM_CACHE_LINE_SIZE];
+    _Atomic uint64_t tail;   // total bytes ever released by the consumer
+    char _pad2[FUZZ_SHM_CACHE_LINE_SIZE];
+} fuzz_shm_ring_header_t;
+
+
+
+// Round up to the next power of two (minimum one page).
+static size_t __shm_round_pow2( size_t x, size_t page ) {
+    size_t r = page;
+    while ( r < x && r < ((size_t)1 << 62) )  r <<= 1;
+    return r;
+}
+
+
+// Map the header page plus the data region TWICE back-to-back over one reserved
+//   span, so a record crossing the wrap point is still a single contiguous write
+//   (and a single contiguous read on the consumer side) -- no split-record logic
+//   anywhere on the fast path. Returns non-zero on success.
+static int __shm_map_ring( fuzz_shm_ring_t* p_ring, size_t hdr_size, size_t capacity ) {
+    size_t span = hdr_size + (2 * capacity);
+
+    // Reserve the whole window first, then punch the real mappings in with
+    //   MAP_FIXED; this guarantees the two data views end up adjacent.
+    void* p_base = mmap( NULL, span, PROT_NONE,
+        (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE), -1, 0 );
+    if ( MAP_FAILED == p_base )  return 0;
+
+    if (
+        MAP_FAILED == mmap( p_base, hdr_size, (PROT_READ | PROT_WRITE),
+            (MAP_SHARED | MAP_FIXED), p_ring->fd, 0 )
+        || MAP_FAILED == mmap( ((unsigned char*)p_base + hdr_size), capacity,
+            (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_FIXED), p_ring->fd, hdr_size )
+        || MAP_FAILED == mmap( ((unsigned char*)p_base + hdr_size + capacity), capacity,
+            (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_FIXED), p_ring->fd, hdr_size )
+    ) {
+        munmap( p_base, span );
+        return 0;
+    }
+
+    p_ring->p_map_base = p_base;
+    p_ring->map_span = span;
+    p_ring->p_hdr = (fuzz_shm_ring_header_t*)p_base;
+    p_ring->p_data = ((unsigned char*)p_base + hdr_size);
+    p_ring->capacity = capacity;
+
+    return 1;
+}
+
+
+// Create a new ring over a fresh anonymous memfd.
+fuzz_shm_ring_t* ShmRing__new( size_t capacity ) {
+    if ( capacity < 1 )  return NULL;
+
+    size_t page = (size_t)sysconf( _SC_PAGESIZE );
+    capacity = __shm_round_pow2( capacity, page );
+
+    fuzz_shm_ring_t* p_ring = (fuzz_shm_ring_t*)calloc( 1, sizeof(fuzz_shm_ring_t) );
+    if ( NULL == p_ring )  return NULL;
+
+    p_ring->fd = memfd_create( "nanofuzz-ring", 0 );
+    if ( p_ring->fd < 0 )  goto __shm_new_err;
+
+    if (  ftruncate( p_ring->fd, (off_t)(page + capacity) ) < 0  )
+        goto __shm_new_err;
+
+    if (  !__shm_map_ring( p_ring, page, capacity )  )
+        goto __shm_new_err;
+
+    p_ring->is_owner = 1;
+
+    // Stamp the shared header so attachers can validate what they received.
+    p_ring->p_hdr->magic = FUZZ_SHM_RING_MAGIC;
+    p_ring->p_hdr->version = FUZZ_SHM_RING_VERSION;
+    p_ring->p_hdr->capacity = capacity;
+    atomic_store_explicit( &(p_ring->p_hdr->head), 0, memory_order_relaxed );
+    atomic_store_explicit( &(p_ring->p_hdr->tail), 0, memory_order_relaxed );
+
+    return p_ring;
+
+    __shm_new_err:
+        if ( p_ring->fd >= 0 )  close( p_ring->fd );
+        free( p_ring );
+        return NULL;
+}
+
+
+// Attach to an existing ring through its received fd.
+fuzz_shm_ring_t* ShmRing__attach( int fd ) {
+    if ( fd < 0 )  return NULL;
+
+    size_t page = (size_t)sysconf( _SC_PAGESIZE );
+
+    fuzz_shm_ring_t* p_ring = (fuzz_shm_ring_t*)calloc( 1, sizeof(fuzz_shm_ring_t) );
+    if ( NULL == p_ring )  return NULL;
+
+    p_ring->fd = fd;
+
+    // Peek the header alone first: the data-region size needed for the full
+    //   double mapping isn't known until the shared capacity has been read.
+    fuzz_shm_ring_header_t* p_peek = (fuzz_shm_ring_header_t*)mmap( NULL, page,
+        PROT_READ, MAP_SHARED, fd, 0 );
+    if ( MAP_FAILED == p_peek )  goto __shm_attach_err;
+
+    uint64_t magic = p_peek->magic;
+    uint64_t version = p_peek->version;
+    uint64_t capacity = p_peek->capacity;
+    munmap( p_peek, page );
+
+    if (
+           FUZZ_SHM_RING_MAGIC != magic
+        || FUZZ_SHM_RING_VERSION != version
+        || capacity < page
+        || 0 != ( capacity & (capacity - 1) )   //must be a power of two
+    )  goto __shm_attach_err;
+
+    if (  !__shm_map_ring( p_ring, page, (size_t)capacity )  )
+        goto __shm_attach_err;
+
+    return p_ring;
+
+    __shm_attach_err:
+        free( p_ring );
+        return NULL;
+}
+
+
+// Unmap and close one side's handle on the ring.
+void ShmRing__delete( fuzz_shm_ring_t* p_ring ) {
+    if ( NULL == p_ring )  return;
+
+    if ( NULL != p_ring->p_map_base )
+        munmap( p_ring->p_map_base, p_ring->map_span );
+
+    if ( p_ring->fd >= 0 )
+        close( p_ring->fd );
+
+    free( p_ring );
+}
+
+
+// Generate one length-prefixed record in place inside the ring.
+long long int ShmRing__produce( fuzz_shm_ring_t* p_ring, fuzz_gen_ctx_t* p_gen_ctx ) {
+    if ( NULL == p_ring || NULL == p_gen_ctx )  return -2;
+
+    // Worst-case room this output could need; +2 mirrors the generator pool's
+    //   own slack for the interpreter's limit check and a trailing terminator.
+    size_t worst = FUZZ_SHM_RING_PREFIX
+        + (p_gen_ctx->p_factory->max_output_size) + 2;
+    if ( worst > p_ring->capacity )  return -2;   //ring can never fit an output
+
+    uint64_t head = atomic_load_explicit( &(p_ring->p_hdr->head), memory_order_relaxed );
+    uint64_t tail = atomic_load_explicit( &(p_ring->p_hdr->tail), memory_order_acquire );
+
+    if ( (head - tail) + worst > p_ring->capacity )
+        return -1;   //not enough drained room right now; caller backs off
+
+    // The double mapping makes this slot contiguous even across the wrap point.
+    unsigned char* p_slot = p_ring->p_data + (head & (p_ring->capacity - 1));
+
+    long long int len = Generator__get_next_into( p_gen_ctx,
+        (p_slot + FUZZ_SHM_RING_PREFIX), (worst - FUZZ_SHM_RING_PREFIX) );
+    if ( len < 0 )  return -2;
+
+    // Prefix the record, then publish it by advancing 'head'; the release store
+    //   pairs with the consumer's acquire load so the bytes land first.
+    uint32_t reclen = (uint32_t)len;
+    memcpy( p_slot, &reclen, FUZZ_SHM_RING_PREFIX );
+
+    atomic_store_explicit( &(p_ring->p_hdr->head),
+        head + FUZZ_SHM_RING_PREFIX + (uint64_t)len, memory_order_release );
+
+    return len;
+}
+
+
+// Pop the oldest record without copying it out of the shared mapping.
+const void* ShmRing__consume( fuzz_shm_ring_t* p_ring, size_t* p_len ) {
+    if ( NULL == p_ring || NULL == p_len || 0 != p_ring->pending_release )
+        return NULL;
+
+    uint64_t tail = atomic_load_explicit( &(p_ring->p_hdr->tail), memory_order_relaxed );
+    uint64_t head = atomic_load_explicit( &(p_ring->p_hdr->head), memory_order_acquire );
+
+    if ( head == tail )  return NULL;   //empty
+
+    const unsigned char* p_slot = p_ring->p_data + (tail & (p_ring->capacity - 1));
+
+    uint32_t reclen;
+    memcpy( &reclen, p_slot, FUZZ_SHM_RING_PREFIX );
+
+    *p_len = (size_t)reclen;
+    p_ring->pending_release = FUZZ_SHM_RING_PREFIX + (size_t)reclen;
+
+    return (const void*)(p_slot + FUZZ_SHM_RING_PREFIX);
+}
+
+
+// Return the consumed record's space to the producer.
+void ShmRing__release( fuzz_shm_ring_t* p_ring ) {
+    if ( NULL == p_ring || 0 == p_ring->pending_release )  return;
+
+    // Release ordering: the consumer must be DONE reading the bytes before the
+    //   producer is allowed to overwrite them.
+    atomic_fetch_add_explicit( &(p_ring->p_hdr->tail),
+        (uint64_t)p_ring->pending_release, memory_order_release );
+
+    p_ring->pending_release = 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * shm_ring.h
+ *
+ * Shared-memory ring output mode: the generator writes length-prefixed
+ *   records straight into a memfd-backed ring which a separate harness
+ *   process mmaps and drains, with no copies and no syscalls on the
+ *   fast path of either side.
+ *
+ */
+
+#ifndef NANOFUZZ_SHM_RING_H
+#define NANOFUZZ_SHM_RING_H
+
+#include "generator.h"
+
+#include <stdint.h>
+
+
+
+// Sanity marker and layout revision stamped into the shared header page, so an
+//   attaching consumer can reject fds that aren't (compatible) nanofuzz rings.
+#define FUZZ_SHM_RING_MAGIC 0x5A465552474E414EULL   /* "NANGRUFZ" */
+#define FUZZ_SHM_RING_VERSION 1
+
+// Per-record length prefix width inside the ring's data region.
+#define FUZZ_SHM_RING_PREFIX sizeof(uint32_t)
+
+
+// One process's handle on a ring. Only the mapping itself is shared; this
+//   struct is process-local bookkeeping around it.
+typedef struct _fuzz_shm_ring_t {
+    int fd;                  // memfd backing the ring; pass to the consumer process
+    int is_owner;            // non-zero on the creating (producer) side
+    void* p_map_base;        // base of the whole reserved mapping (header page first)
+    size_t map_span;         // reserved address-space length (header + 2x data)
+    struct _fuzz_shm_ring_header_t* p_hdr;   // shared control page
+    unsigned char* p_data;   // start of the data region (mapped TWICE back-to-back)
+    size_t capacity;         // data region size in bytes (power of two)
+    size_t pending_release;  // bytes the last consume call still owes to 'tail'
+} fuzz_shm_ring_t;
+
+
+
+// Create a new ring whose data region holds at least 'capacity' bytes (rounded up
+//   to a power-of-two multiple of the page size). The backing memfd is anonymous;
+//   hand its fd (see the struct) to the consumer process over any ordinary channel
+//   (fork inheritance, SCM_RIGHTS, ...). Returns NULL on failure.
+fuzz_shm_ring_t* ShmRing__new( size_t capacity );
+
+// Attach to a ring created elsewhere through its (received) fd. The header page
+//   is validated against the magic/version above. Returns NULL on failure.
+fuzz_shm_ring_t* ShmRing__attach( int fd );
+
+// Unmap and close one side's handle. The kernel frees the memfd itself once the
+//   last attached process lets go.
+void ShmRing__delete( fuzz_shm_ring_t* p_ring );
+
+// Generate the next output DIRECTLY into the ring as one length-prefixed record;
+//   the bytes are written in place, so nothing is ever copied. Returns the record's
+//   generated length, -1 when the ring currently lacks room for a worst-case output
+//   (back off and retry once the consumer drains), or -2 on a generation fault.
+long long int ShmRing__produce( fuzz_shm_ring_t* p_ring, fuzz_gen_ctx_t* p_gen_ctx );
+
+// Pop the oldest record, returning a pointer to its bytes INSIDE the shared mapping
+//   and storing its length through 'p_len'. Returns NULL when the ring is empty.
+//   The bytes stay valid until the matching release call below; exactly one record
+//   may be outstanding per handle at a time.
+const void* ShmRing__consume( fuzz_shm_ring_t* p_ring, size_t* p_len );
+
+// Hand the most recently consumed record's space back to the producer.
+void ShmRing__release( fuzz_shm_ring_t* p_ring );
+
+
+
+#endif   /* NANOFUZZ_SHM_RING_H */
@@ -8,9 +8,72 @@
 
 #include "stats.h"
 
+#include <string.h>
 
 
-// Define the struct used by StatsBlockPtr_t in the header file.
-struct _fuzz_stats_block_t {
-    
+
+// Printable names for the per-block-type execution counters, indexed by
+//   pattern_block_type (slot 0 is never generated and thus never printed).
+static const char* const __block_type_names[FUZZ_STATS_BLOCK_TYPES] = {
+    [reference]   = "reference",
+    [string]      = "string",
+    [range]       = "range",
+    [sub]         = "sub",
+    [ret]         = "ret",
+    [branch_root] = "branch_root",
+    [branch_jmp]  = "branch_jmp",
+    [end]         = "end"
 };
+
+
+
+// Zero out a statistics block.
+void Stats__reset( fuzz_stats_block_t* p_stats ) {
+    if ( NULL == p_stats )  return;
+
+    memset( p_stats, 0, sizeof(fuzz_stats_block_t) );
+}
+
+
+// Accumulate one statistics block into another.
+void Stats__merge( fuzz_stats_block_t* p_dest, const fuzz_stats_block_t* p_src ) {
+    if ( NULL == p_dest || NULL == p_src )  return;
+
+    p_dest->outputs_generated += p_src->outputs_generated;
+    p_dest->bytes_generated   += p_src->bytes_generated;
+    p_dest->overflow_events   += p_src->overflow_events;
+
+    for ( size_t i = 0; i < FUZZ_STATS_BLOCK_TYPES; i++ )
+        p_dest->block_executions[i] += p_src->block_executions[i];
+
+    // The high-water mark is a maximum, not a sum.
+    if ( p_src->pool_high_water > p_dest->pool_high_water )
+        p_dest->pool_high_water = p_src->pool_high_water;
+}
+
+
+// Write a human-readable dump of the statistics block to the given stream.
+void Stats__print( FILE* fp_stream, const fuzz_stats_block_t* p_stats ) {
+    if ( NULL == fp_stream || NULL == p_stats )  return;
+
+    double avg = ( p_stats->outputs_generated > 0 )
+        ? ( (double)(p_stats->bytes_generated) / (double)(p_stats->outputs_generated) )
+        : 0.0;
+
+    fprintf( fp_stream, "=== Generation Statistics ===\n" );
+    fprintf( fp_stream, "\tOutputs generated: %llu\n", p_stats->outputs_generated );
+    fprintf( fp_stream, "\tBytes produced: %llu (avg %.1f bytes per output)\n",
+        p_stats->bytes_generated, avg );
+    fprintf( fp_stream, "\tPool high-water mark: %llu bytes\n", p_stats->pool_high_water );
+    fprintf( fp_stream, "\tOverflow/fault events: %llu\n", p_stats->overflow_events );
+
+    fprintf( fp_stream, "\tBlock executions:\n" );
+    for ( size_t i = 1; i < FUZZ_STATS_BLOCK_TYPES; i++ ) {
+        if ( !(p_stats->block_executions[i]) )  continue;
+
+        fprintf( fp_stream, "\t\t%-11s : %llu\n",
+            __block_type_names[i], p_stats->block_executions[i] );
+    }
+
+    fprintf( fp_stream, "\n" );
+}
@@ -9,10 +9,41 @@
 #ifndef NANOFUZZ_STATS_H
 #define NANOFUZZ_STATS_H
 
+#include "pattern.h"
 
+#include <stdio.h>
+
+
+
+// Amount of slots needed to count every pattern_block_type (plus slot 0, unused).
+#define FUZZ_STATS_BLOCK_TYPES ((end) + 1)
+
+// Per-generator-context statistics block. Every generator context embeds one of
+//   these and bumps its counters as PLAIN (non-atomic) increments on the hot path;
+//   each context is only ever driven by a single thread, so the counters stay
+//   coherent without synchronization and are merged on read instead.
+typedef struct _fuzz_stats_block_t {
+    unsigned long long outputs_generated;   // completed interpreter runs
+    unsigned long long bytes_generated;     // total bytes emitted by those runs
+    // Executed-instruction counts, indexed directly by pattern_block_type.
+    unsigned long long block_executions[FUZZ_STATS_BLOCK_TYPES];
+    unsigned long long pool_high_water;     // largest single output seen, in bytes
+    unsigned long long overflow_events;     // generation faults (__gen_overflow hits)
+} fuzz_stats_block_t;
 
 typedef struct _fuzz_stats_block_t* StatsBlockPtr_t;
 
 
 
+// Zero out a statistics block, usually ahead of a merge.
+void Stats__reset( fuzz_stats_block_t* p_stats );
+
+// Accumulate 'p_src' into 'p_dest': counters sum, the high-water mark takes the max.
+void Stats__merge( fuzz_stats_block_t* p_dest, const fuzz_stats_block_t* p_src );
+
+// Write a human-readable dump of the statistics block to the given stream.
+void Stats__print( FILE* fp_stream, const fuzz_stats_block_t* p_stats );
+
+
+
 #endif   /* NANOFUZZ_STATS_H */
@@ -13,6 +13,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 #include <criterion/criterion.h>
 
@@ -90,6 +92,14 @@ TEST_VALID(staticstr3, "a\\<\\[A-Z\\]\\]");
 TEST_VALID(staticstr4, "aaa\\{aa");
 TEST_VALID(staticstr5, "aa\\r\\n\\r\\n\\b\\xff\\v\\t\\0raaa\\\\");
 
+// Branch weights. Static-string snipping means a weight binds to the token
+//   right after it, so weighted alternatives are written parenthesized.
+TEST_VALID(branchweight1, "(<*9>(ok)|(bad))");                // first alternative
+TEST_VALID(branchweight2, "((ok)|<*5>(bad))");                // later alternative
+TEST_VALID(branchweight3, "(<*3>(a)|<*2>(b)|<*1>(c))");      // all weighted
+TEST_VALID(branchweight4, "<*9>(head)|(tail)");               // unparenthesized root branch
+TEST_VALID(branchweight5, "(<*65535>(a)|(b))");               // ceiling value
+
 // Repetition mechanisms.
 TEST_VALID(repetition1,  "a{1,3}bcd");
 TEST_VALID(repetition2,  "a{,3}bcd");
@@ -137,8 +147,157 @@ TEST_DEAD(repetition6, "a{3,5\\}}bcd");
 TEST_DEAD(repetition7, "a\\{3,5}bcd");
 
 
+// Branch weights.
+TEST_DEAD(branchweight1, "(<*0>(a)|(b))");        // zero weight
+TEST_DEAD(branchweight2, "(<*65536>(a)|(b))");    // above the uint16 ceiling
+TEST_DEAD(branchweight3, "<*3>abc");              // no branch to weight
+TEST_DEAD(branchweight4, "(<*3>ab(c)|(d))");      // not directly preceding the alternative
+TEST_DEAD(branchweight5, "(a|b<*3>|c)");          // mid-alternative
+TEST_DEAD(branchweight6, "a|b<*3>");              // trailing, after alternative content
+TEST_DEAD(branchweight7, "(<*3>)");               // weight with nothing to choose
+
 // Subsequence mechanisms and nesting.
 TEST_DEAD(subsequence1, "a(bcd");
 
 // Range mechanisms.
 TEST_DEAD(range1, "123[A-Z456");
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// TESTS FOR THE COMPILED-PATTERN LOADER.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+// A pattern exercising every operand kind the loader fixes up: static strings,
+//   ranges, variable references (paste AND length), and a weighted branch with jumps.
+static const char* p_loader_pattern =
+    "head-(<*9>(ab)|(c))([0-9]{2})<$V>x{1,3}<#x4:V><@V>{2}[a-f]{4,8}tail";
+#define LOADER_TEST_FILE "/tmp/nanofuzz_loader_test.nfz"
+
+// Compile and save the reference image once, returning its raw bytes.
+static size_t __loader_build_image( unsigned char** pp_buf ) {
+    fuzz_factory_t* p_fact = PatternFactory__new( p_loader_pattern, &p_err_ctx );
+    cr_assert( NULL != p_fact, "The loader test pattern must compile." );
+    cr_assert( PatternFactory__save( p_fact, LOADER_TEST_FILE ),
+        "The compiled factory must save cleanly." );
+    PatternFactory__delete( p_fact );
+
+    FILE* fp = fopen( LOADER_TEST_FILE, "rb" );
+    cr_assert( NULL != fp, "The saved image must be readable." );
+    fseek( fp, 0, SEEK_END );
+    size_t len = (size_t)ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    *pp_buf = malloc( len );
+    cr_assert( 1 == fread( *pp_buf, len, 1, fp ), "The saved image must read back." );
+    fclose( fp );
+
+    return len;
+}
+
+// Write an (optionally mutated) image and attempt to load it.
+static fuzz_factory_t* __loader_try_image( const unsigned char* p_buf, size_t len ) {
+    FILE* fp = fopen( LOADER_TEST_FILE, "wb" );
+    cr_assert( NULL != fp, "The mutated image must be writable." );
+    if ( len > 0 )
+        cr_assert( 1 == fwrite( p_buf, len, 1, fp ), "The mutated image must write." );
+    fclose( fp );
+
+    return PatternFactory__load_mmap( LOADER_TEST_FILE, &p_err_ctx );
+}
+
+// A factory the loader accepted -- intact or not -- must generate without faulting.
+static void __loader_exercise( fuzz_factory_t* p_fact ) {
+    nanofuzz_context_t* p_ctx = Nanofuzz__new_from_factory( p_fact, 8, oneshot );
+    if ( NULL == p_ctx ) {
+        PatternFactory__delete( p_fact );
+        return;
+    }
+    for ( int i = 0; i < 8; i++ ) {
+        nanofuzz_data_t* p_data = Nanofuzz__get_next( p_ctx );
+        if ( NULL == p_data )  break;
+        Nanofuzz__delete_data( p_ctx, p_data );
+    }
+    Nanofuzz__delete( p_ctx );
+}
+
+// Sanity: an untouched image must round-trip and generate.
+Test(compiled_loader, roundtrip, .init = _pattern_setup, .fini = _pattern_teardown) {
+    unsigned char* p_orig = NULL;
+    size_t len = __loader_build_image( &p_orig );
+
+    fuzz_factory_t* p_fact = __loader_try_image( p_orig, len );
+    cr_assert( NULL != p_fact, "An intact compiled image must load." );
+    __loader_exercise( p_fact );
+
+    free( p_orig );
+}
+
+// Truncations at every length must be rejected or, at worst, still generate.
+Test(compiled_loader, truncated, .init = _pattern_setup, .fini = _pattern_teardown) {
+    unsigned char* p_orig = NULL;
+    size_t len = __loader_build_image( &p_orig );
+
+    for ( size_t cut = 0; cut < len; cut++ ) {
+        fuzz_factory_t* p_fact = __loader_try_image( p_orig, cut );
+        if ( NULL != p_fact )
+            __loader_exercise( p_fact );
+    }
+
+    free( p_orig );
+}
+
+// Single-byte corruption sweep: force every byte to 0x00 and 0xFF in turn. The
+//   loader either rejects the image outright (wild counts, offsets, jump targets)
+//   or hands back a factory whose generation cannot walk out of bounds.
+Test(compiled_loader, corrupted, .init = _pattern_setup, .fini = _pattern_teardown) {
+    unsigned char* p_orig = NULL;
+    size_t len = __loader_build_image( &p_orig );
+    unsigned char* p_mut = malloc( len );
+
+    for ( size_t i = 0; i < len; i++ ) {
+        for ( int pass = 0; pass < 2; pass++ ) {
+            unsigned char v = pass ? 0x00 : 0xFF;
+            if ( p_orig[i] == v )  continue;
+
+            memcpy( p_mut, p_orig, len );
+            p_mut[i] = v;
+
+            fuzz_factory_t* p_fact = __loader_try_image( p_mut, len );
+            if ( NULL != p_fact )
+                __loader_exercise( p_fact );
+        }
+    }
+
+    free( p_mut );
+    free( p_orig );
+}
+
+// Wild offsets: a root_offset near UINT64_MAX must not wrap the loader's bound
+//   check, and stamping the root record's own offset over every aligned 8-byte
+//   slot (so any slot holding a sub record's factory_offset now cycles back to
+//   the root) must be rejected by the recursion guard rather than recursed.
+Test(compiled_loader, wild_offsets, .init = _pattern_setup, .fini = _pattern_teardown) {
+    unsigned char* p_orig = NULL;
+    size_t len = __loader_build_image( &p_orig );
+    unsigned char* p_mut = malloc( len );
+
+    memcpy( p_mut, p_orig, len );
+    unsigned long long wild = 0xFFFFFFFFFFFFFFF0ULL;
+    memcpy( (p_mut + 16), &wild, sizeof(wild) );   //header root_offset
+    cr_assert( NULL == __loader_try_image( p_mut, len ),
+        "A wrapping root offset must fail the load." );
+
+    unsigned long long root_off = 0;
+    memcpy( &root_off, (p_orig + 16), sizeof(root_off) );
+    for ( size_t i = 0; (i + 8) <= len; i += 8 ) {
+        memcpy( p_mut, p_orig, len );
+        memcpy( (p_mut + i), &root_off, sizeof(root_off) );
+
+        fuzz_factory_t* p_fact = __loader_try_image( p_mut, len );
+        if ( NULL != p_fact )
+            __loader_exercise( p_fact );
+    }
+
+    free( p_mut );
+    free( p_orig );
+}
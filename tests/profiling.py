@@ -44,8 +44,18 @@ execall = [ myfullpath+"/../bin/nanofuzz", "-l", str(count), "-f", myfullpath+"/
 print( "\tExecuting nanofuzz" )
 proc = subprocess.Popen( execall, stdout=subprocess.PIPE )
 
+edges = []
 for line in proc.stdout.readlines():
-    x = [ p.strip().replace('|', '') for p in line.decode("utf-8").split("-->") ]
+    decoded = line.decode("utf-8")
+
+    # Merged per-edge lines: '|callee| <-- |caller| ==> calls'.
+    if "<--" in decoded and "==>" in decoded:
+        m = re.match( r'\s*\|(\S+)\| <-- \|(\S+)\| ==> (\d+)', decoded )
+        if m:
+            edges.append( {"callee":m.group(1), "caller":m.group(2), "amnt":int(m.group(3))} )
+        continue
+
+    x = [ p.strip().replace('|', '') for p in decoded.split("-->") ]
     if len(x) < 3:
         continue
 
@@ -87,4 +97,33 @@ for y in symbols_sorted:
     print( "| {:<48} | {:<16} | {:<16} |".format( y["name"], y["time"], y["amnt"] ) )
 
 
+# Break the hottest call counts down by caller, using the merged edge section.
+#   Callers are CALL-SITE addresses rather than function entry points, so they are
+#   resolved to the nearest preceding symbol (the containing function).
+symbol_starts = sorted( [ (int(a, 16), symbols[a]["name"]) for a in symbols.keys() ] )
+
+def edge_name( addr ):
+    if addr in symbols.keys():
+        return symbols[addr]["name"]
+    try:
+        target = int( addr, 16 )
+    except:
+        return addr
+    best = addr
+    for start, name in symbol_starts:
+        if start > target:
+            break
+        best = name
+    return best
+
+if len( edges ) > 0:
+    edges_sorted = sorted( edges, key=lambda x: x["amnt"] )
+    edges_sorted.reverse()
+
+    print( "\n\n| {:<40} | {:<40} | {:<12} |".format('CALLER','CALLEE','CALLS') )
+    for y in edges_sorted:
+        print( "| {:<40} | {:<40} | {:<12} |".format(
+            edge_name(y["caller"]), edge_name(y["callee"]), y["amnt"] ) )
+
+
 print( "\n\n" )
@@ -0,0 +1,153 @@
+/*
+ * shm_ring_tests.c
+ *
+ * Tests the shared-memory ring output mode: header validation on attach, the
+ *   producer/consumer record protocol inside one process (including records
+ *   which cross the wrap point), and the real cross-process path with a forked
+ *   consumer draining a ring it attached through the inherited memfd.
+ *
+ */
+
+#define _GNU_SOURCE   /* memfd_create */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <criterion/criterion.h>
+
+#include "../src/api.h"
+#include "../src/shm_ring.h"
+
+
+// Variable-length records so a long run repeatedly lands records across the
+//   ring's wrap point; every byte is checkable without tracking the PRNG.
+static const char* p_ring_pattern = "[a-z]{1,64}";
+
+// Validate one consumed record against the pattern above.
+static int __ring_record_ok( const unsigned char* p_rec, size_t len ) {
+    if ( len < 1 || len > 64 )  return 0;
+
+    for ( size_t i = 0; i < len; i++ )
+        if ( p_rec[i] < 'a' || p_rec[i] > 'z' )  return 0;
+
+    return 1;
+}
+
+
+// Attach must reject fds that aren't (compatible) nanofuzz rings.
+Test(shm_ring, attach_validation) {
+    cr_assert( NULL == ShmRing__attach( -1 ), "A bad fd must not attach." );
+
+    // A memfd with a garbage header page must be rejected by the magic check.
+    int fd = memfd_create( "nanofuzz-ring-test", 0 );
+    cr_assert( fd >= 0, "The test memfd must create." );
+    cr_assert( 0 == ftruncate( fd, (off_t)(2 * sysconf( _SC_PAGESIZE )) ),
+        "The test memfd must size." );
+    cr_assert( NULL == ShmRing__attach( fd ), "A non-ring memfd must not attach." );
+    close( fd );
+}
+
+
+// Single-process protocol check: fill/drain cycles push the cursors far enough
+//   that records cross the wrap point many times, and every record must come
+//   back intact and in order through the zero-copy consume/release pair.
+Test(shm_ring, produce_consume_wraps) {
+    nanofuzz_error_t* p_err = NULL;
+    fuzz_factory_t* p_fact = PatternFactory__new( p_ring_pattern, &p_err );
+    cr_assert( NULL != p_fact, "The ring test pattern must compile." );
+
+    fuzz_gen_ctx_t* p_gen_ctx = Generator__new_context( p_fact );
+    cr_assert( NULL != p_gen_ctx, "The generator context must build." );
+
+    fuzz_shm_ring_t* p_ring = ShmRing__new( 4096 );
+    cr_assert( NULL != p_ring, "The ring must create." );
+
+    // Far more record bytes than one capacity's worth, so the window wraps over
+    //   and over; interleave a slight fill-ahead to exercise the backoff path.
+    size_t produced = 0, consumed = 0;
+    while ( consumed < 2000 ) {
+        while (  produced < 2000 && ShmRing__produce( p_ring, p_gen_ctx ) >= 0  )
+            produced++;
+
+        size_t len = 0;
+        const void* p_rec = ShmRing__consume( p_ring, &len );
+        cr_assert( NULL != p_rec, "A produced record must be consumable." );
+        cr_assert( __ring_record_ok( (const unsigned char*)p_rec, len ),
+            "Record %zu came back malformed (len %zu).", consumed, len );
+        ShmRing__release( p_ring );
+        consumed++;
+    }
+
+    // Drained completely: the ring must read empty again.
+    size_t len = 0;
+    cr_assert( NULL == ShmRing__consume( p_ring, &len ),
+        "A drained ring must consume NULL." );
+
+    ShmRing__delete( p_ring );
+    Generator__delete_context( p_gen_ctx );   //owns (and frees) the factory
+}
+
+
+// The real shape of the mode: the consumer is a SEPARATE process which attaches
+//   through the inherited memfd and drains records the parent generates.
+Test(shm_ring, fork_producer_consumer) {
+    nanofuzz_error_t* p_err = NULL;
+    fuzz_factory_t* p_fact = PatternFactory__new( p_ring_pattern, &p_err );
+    cr_assert( NULL != p_fact, "The ring test pattern must compile." );
+
+    fuzz_gen_ctx_t* p_gen_ctx = Generator__new_context( p_fact );
+    cr_assert( NULL != p_gen_ctx, "The generator context must build." );
+
+    fuzz_shm_ring_t* p_ring = ShmRing__new( 4096 );
+    cr_assert( NULL != p_ring, "The ring must create." );
+
+    const size_t total = 2000;
+    pid_t pid = fork();
+    cr_assert( pid >= 0, "The consumer process must fork." );
+
+    if ( 0 == pid ) {
+        // Consumer side: attach a fresh handle over the inherited fd and drain.
+        fuzz_shm_ring_t* p_cons = ShmRing__attach( p_ring->fd );
+        if ( NULL == p_cons )  _exit( 1 );
+
+        size_t got = 0;
+        while ( got < total ) {
+            size_t len = 0;
+            const void* p_rec = ShmRing__consume( p_cons, &len );
+            if ( NULL == p_rec ) {
+                usleep( 100 );   //empty; wait for the producer
+                continue;
+            }
+            if (  !__ring_record_ok( (const unsigned char*)p_rec, len )  )
+                _exit( 2 );
+            ShmRing__release( p_cons );
+            got++;
+        }
+
+        ShmRing__delete( p_cons );
+        _exit( 0 );
+    }
+
+    // Producer side: push every record, backing off while the consumer drains.
+    size_t sent = 0;
+    while ( sent < total ) {
+        long long int rc = ShmRing__produce( p_ring, p_gen_ctx );
+        if ( -1 == rc ) {
+            usleep( 100 );   //ring momentarily full
+            continue;
+        }
+        cr_assert( rc >= 0, "Production faulted mid-run (rc %lld).", rc );
+        sent++;
+    }
+
+    int status = 0;
+    cr_assert( pid == waitpid( pid, &status, 0 ), "The consumer must be reaped." );
+    cr_assert( WIFEXITED( status ) && 0 == WEXITSTATUS( status ),
+        "The consumer exited abnormally (status %d).", status );
+
+    ShmRing__delete( p_ring );
+    Generator__delete_context( p_gen_ctx );   //owns (and frees) the factory
+}